@@ -0,0 +1,68 @@
+function results = read_results(filename)
+% READ_RESULTS  load a results.YYYY.col file written by the simulator
+%   results = read_results('results.2003.col') returns a struct with the
+%   year and one field per table (vessels, days). Each table is a struct
+%   of column vectors; dictionary-encoded columns come back as cell arrays
+%   of strings.
+
+fid = fopen(filename, 'r', 'l');
+if fid < 0
+    error('read_results: cannot open %s', filename);
+end
+
+magic = fread(fid, [1 4], '*char');
+header = fread(fid, 5, 'int32');
+if ~strcmp(magic, 'COLF') || header(1) ~= 1
+    fclose(fid);
+    error('read_results: %s is not a column file', filename);
+end
+results.year = header(2);
+num_tables = header(3);
+num_columns = header(4);
+
+% table and column directories
+for t = 1:num_tables
+    tables(t).name = deblank(fread(fid, [1 24], '*char'));
+    fields = fread(fid, 4, 'int32');
+    tables(t).num_rows = fields(1);
+    tables(t).first_column = fields(2);
+    tables(t).num_columns = fields(3);
+end
+for c = 1:num_columns
+    columns(c).name = deblank(fread(fid, [1 32], '*char'));
+    fields = fread(fid, 2, 'int32');
+    columns(c).type = fields(1);
+    columns(c).dict_count = fields(2);
+    offsets = fread(fid, 2, 'int64');
+    columns(c).offset = offsets(1);
+    columns(c).dict_offset = offsets(2);
+end
+
+% column data
+for t = 1:num_tables
+    n = tables(t).num_rows;
+    table = struct();
+    for c = tables(t).first_column + (1:tables(t).num_columns)
+        fseek(fid, columns(c).offset, 'bof');
+        switch columns(c).type
+            case 0
+                values = fread(fid, n, 'double');
+            case 1
+                values = fread(fid, n, 'int32');
+            case 2
+                codes = fread(fid, n, 'int32');
+                fseek(fid, columns(c).dict_offset, 'bof');
+                offsets = fread(fid, columns(c).dict_count + 1, 'int32');
+                chars = fread(fid, [1 offsets(end)], '*char');
+                dictionary = cell(columns(c).dict_count, 1);
+                for k = 1:columns(c).dict_count
+                    dictionary{k} = chars(offsets(k)+1:offsets(k+1));
+                end
+                values = dictionary(codes + 1);
+        end
+        table.(columns(c).name) = values;
+    end
+    results.(tables(t).name) = table;
+end
+
+fclose(fid);
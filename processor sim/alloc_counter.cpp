@@ -0,0 +1,142 @@
+/*
+ *  alloc_counter.cpp
+ *  processor
+ *
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "alloc_counter.h"
+
+using namespace std;
+
+static atomic<bool> counting(false);
+static atomic<long long> num_allocations(0);
+
+void set_allocation_counting(const bool enabled)
+{
+	counting.store(enabled, memory_order_relaxed);
+	return;
+}
+
+bool allocation_counting()
+{
+	return counting.load(memory_order_relaxed);
+}
+
+long long allocation_count()
+{
+	return num_allocations.load(memory_order_relaxed);
+}
+
+static inline void count_allocation()
+{
+	if(counting.load(memory_order_relaxed))
+		num_allocations.fetch_add(1, memory_order_relaxed);
+	return;
+}
+
+static void * allocate(size_t size)
+{
+	count_allocation();
+	return malloc(size == 0 ? 1 : size);
+}
+
+static void * allocate_aligned(size_t size, align_val_t alignment)
+{
+	count_allocation();
+	size_t align = size_t(alignment);
+	if(align < sizeof(void *))
+		align = sizeof(void *);
+	void * block = NULL;
+	if(posix_memalign(&block, align, size == 0 ? 1 : size) != 0)
+		return NULL;
+	return block;
+}
+
+void * operator new(size_t size)
+{
+	void * block = allocate(size);
+	if(block == NULL)
+		throw bad_alloc();
+	return block;
+}
+
+void * operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void * operator new(size_t size, const nothrow_t &) noexcept
+{
+	return allocate(size);
+}
+
+void * operator new[](size_t size, const nothrow_t &) noexcept
+{
+	return allocate(size);
+}
+
+void * operator new(size_t size, align_val_t alignment)
+{
+	void * block = allocate_aligned(size, alignment);
+	if(block == NULL)
+		throw bad_alloc();
+	return block;
+}
+
+void * operator new[](size_t size, align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void * operator new(size_t size, align_val_t alignment, const nothrow_t &) noexcept
+{
+	return allocate_aligned(size, alignment);
+}
+
+void * operator new[](size_t size, align_val_t alignment, const nothrow_t &) noexcept
+{
+	return allocate_aligned(size, alignment);
+}
+
+void operator delete(void * block) noexcept
+{
+	free(block);
+}
+
+void operator delete[](void * block) noexcept
+{
+	free(block);
+}
+
+void operator delete(void * block, size_t) noexcept
+{
+	free(block);
+}
+
+void operator delete[](void * block, size_t) noexcept
+{
+	free(block);
+}
+
+void operator delete(void * block, align_val_t) noexcept
+{
+	free(block);
+}
+
+void operator delete[](void * block, align_val_t) noexcept
+{
+	free(block);
+}
+
+void operator delete(void * block, size_t, align_val_t) noexcept
+{
+	free(block);
+}
+
+void operator delete[](void * block, size_t, align_val_t) noexcept
+{
+	free(block);
+}
@@ -0,0 +1,20 @@
+/*
+ *  alloc_counter.h
+ *  processor
+ *
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+// alloc_counter.cpp replaces the global operator new/delete (plain, array,
+// nothrow and aligned forms) in every binary built from these sources. They
+// only count while counting is on, which the -verify gate turns on around its
+// steady-state runs; otherwise they cost one relaxed load per allocation.
+// Memory from malloc or other allocators is never counted, and neither is
+// the INSTRUMENT profile report, which turns counting off while it is written.
+void set_allocation_counting(const bool enabled);
+bool allocation_counting();
+long long allocation_count();
+
+#endif
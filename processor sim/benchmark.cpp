@@ -0,0 +1,235 @@
+/*
+ *  benchmark.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <functional>
+#include "benchmark.h"
+#include "simulator.h"
+#include "simulator_tools.h"
+#include "csv_buffer.h"
+#include "fleet_generator.h"
+
+// results are folded into this so the compiler cannot drop the work
+static volatile double benchmark_sink;
+
+// time body, doubling the number of calls until a run takes min_seconds
+static benchmark_result time_benchmark(const string & name, const double items, 
+									   const function<void()> & body, const double min_seconds)
+{
+	benchmark_result result;
+	result.name = name;
+	result.items = items;
+	
+	long long iterations = 1;
+	double elapsed;
+	body(); // warm up
+	while(true)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(long long k = 0; k < iterations; k++)
+			body();
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if(elapsed >= min_seconds || iterations >= (1LL << 40))
+			break;
+		iterations *= 2;
+	}
+	result.iterations = iterations;
+	result.ns_per_item = elapsed * 1e9 / (iterations * items);
+	
+	cout << name << ": " << result.ns_per_item << " ns/item (" << iterations << " x " << items << ")\n";
+	return result;
+}
+
+// a simulator loaded with landings_text and set up for one year
+struct year_fixture
+{
+	simulator sim;
+	year_dataset_ptr data;
+	vector<vessel> vessel_data;
+	
+	year_fixture(const string & landings_text, const int year)
+	{
+		istringstream in(landings_text);
+		sim.read_in_landings(in);
+		sim.set_output_sinks(0);
+		data = sim.load_year(year);
+		sim.begin_year(data, vessel_data);
+		sim.load_credit_factors(vessel_data);
+		sim.process_data(vessel_data, year);
+	}
+};
+
+int run_benchmarks(const string & landings_file, const string & results_file, const double min_seconds)
+{
+	ifstream datafile;
+	datafile.open(landings_file.c_str());
+	if(!datafile.is_open())
+	{
+		cerr << "could not open " << landings_file << ".\n";
+		return 1;
+	}
+	stringstream contents;
+	contents << datafile.rdbuf();
+	datafile.close();
+	string real_fleet = contents.str();
+	
+	// a fleet ten times the size, fitted to the real one
+	string large_fleet;
+	{
+		istringstream in(real_fleet);
+		simulator sim;
+		sim.read_in_landings(in);
+		fleet_generator generator;
+		vector<landing> landings;
+		generator.fit(sim.get_landings());
+		generator.generate(10, 1, landings);
+		large_fleet = landings_csv(landings);
+	}
+	
+	// the simulator reports every year on cerr
+	stringstream quiet;
+	streambuf * cerr_buffer = cerr.rdbuf(quiet.rdbuf());
+	vector<benchmark_result> results;
+	
+	// parsing
+	vector<string> lines, dates;
+	{
+		istringstream in(real_fleet);
+		string line_buffer;
+		getline(in, line_buffer);
+		while(lines.size() < 1024 && getline(in, line_buffer))
+		{
+			int position = 0;
+			lines.push_back(line_buffer);
+			parse_line(line_buffer, position);
+			dates.push_back(parse_line(line_buffer, position));
+		}
+	}
+	results.push_back(time_benchmark("parse_line", lines.size(), [&]() {
+		for(int i = 0; i < lines.size(); i++)
+		{
+			int position = 0;
+			while(position != lines[i].length())
+				benchmark_sink = parse_line(lines[i], position).length();
+		}
+	}, min_seconds));
+	results.push_back(time_benchmark("parse_month/parse_day", dates.size(), [&]() {
+		for(int i = 0; i < dates.size(); i++)
+			benchmark_sink = parse_month(dates[i]) + parse_day(dates[i]);
+	}, min_seconds));
+	
+	// calendar
+	results.push_back(time_benchmark("day_count", 4 * 366, [&]() {
+		int total = 0;
+		for(int year = 2000; year < 2004; year++)
+			for(int day = 0; day < 366; day++)
+				total += day_count(year, day / 31 + 1, day % 28 + 1);
+		benchmark_sink = total;
+	}, min_seconds));
+	results.push_back(time_benchmark("day_name", 366, [&]() {
+		for(int day = 0; day < 366; day++)
+			benchmark_sink = day_name(day, 2003).length();
+	}, min_seconds));
+	
+	// penalty functions, scalar and batched
+	const int num_z = 4096;
+	vector<double> z(num_z), p(num_z);
+	for(int i = 0; i < num_z; i++)
+		z[i] = -4.0 + 8.0 * i / num_z;
+	double (*penalties[4])(const double) = {normal_pvalue, shallow_slope, moderate_slope, linear};
+	void (*batches[4])(const double *, double *, const int) = 
+		{normal_pvalue_batch, shallow_slope_batch, moderate_slope_batch, linear_batch};
+	const char * penalty_names[4] = {"normal_pvalue", "shallow_slope", "moderate_slope", "linear"};
+	for(int f = 0; f < 4; f++)
+	{
+		results.push_back(time_benchmark(penalty_names[f], num_z, [&]() {
+			double total = 0;
+			for(int i = 0; i < num_z; i++)
+				total += penalties[f](z[i]);
+			benchmark_sink = total;
+		}, min_seconds));
+		results.push_back(time_benchmark(string(penalty_names[f]) + "_batch", num_z, [&]() {
+			batches[f](z.data(), p.data(), num_z);
+			benchmark_sink = p[num_z - 1];
+		}, min_seconds));
+	}
+	
+	// conversion and replay of a year, on the real and the large fleet
+	const string fleets[2] = {real_fleet, large_fleet};
+	const char * fleet_names[2] = {"real", "x10"};
+	for(int f = 0; f < 2; f++)
+	{
+		year_fixture fixture(fleets[f], 2003);
+		results.push_back(time_benchmark(string("convert_data/") + fleet_names[f], fixture.data->hauls.size(), [&]() {
+			year_dataset data;
+			fixture.sim.convert_data(fixture.sim.get_landings(), 2003, data);
+			benchmark_sink = data.vessels.size();
+		}, min_seconds));
+		results.push_back(time_benchmark(string("simulate_year/") + fleet_names[f], fixture.data->hauls.size(), [&]() {
+			fixture.sim.simulate_year(fixture.vessel_data, 2003);
+			benchmark_sink = fixture.sim.get_vessel_states()[0].actual_pollock_A;
+		}, min_seconds));
+		
+		// one day on which num_needy vessels all need credits from the pool
+		int num_vessels = fixture.vessel_data.size();
+		vector<vessel_state> & states = fixture.sim.get_vessel_states();
+		policy_params params = fixture.sim.get_params();
+		params.trading_rule = FIXED_TRANSFER_TAX;
+		params.TAX_RATE = 0;
+		fixture.sim.set_params(params);
+		for(int num_needy = 1; num_needy <= num_vessels; num_needy *= 10)
+		{
+			shared_ptr<year_dataset> day_data(new year_dataset(*fixture.data));
+			day_data->hauls.assign(num_needy, fixture.data->hauls[0]);
+			day_data->haul_day.assign(num_needy, fixture.data->haul_day[0]);
+			day_data->haul_vessel.resize(num_needy);
+			for(int i = 0; i < num_needy; i++)
+			{
+				day_data->hauls[i].name = fixture.data->vessels[i].name;
+				day_data->hauls[i].chinook = 10;
+				day_data->haul_vessel[i] = i;
+			}
+			fixture.sim.begin_year(day_data, fixture.vessel_data);
+			fixture.sim.load_credit_factors(fixture.vessel_data);
+			for(int i = 0; i < num_needy; i++)
+			{
+				states[i].actual_chinook_A = i + 1;
+				states[i].actual_pollock_A = 100;
+			}
+			int day = day_data->haul_day[0];
+			vessel_state donor;
+			char name[64];
+			sprintf(name, "transfer_credits/%s/%d needy", fleet_names[f], num_needy);
+			results.push_back(time_benchmark(name, num_needy, [&]() {
+				for(int i = 0; i < num_needy; i++)
+					states[i].credits = 0;
+				donor.credits = 20 * num_needy;
+				fixture.sim.bank_unused_credits(donor);
+				fixture.sim.transfer_credits(fixture.vessel_data, 0, day);
+				benchmark_sink = states[0].credits;
+			}, min_seconds));
+		}
+	}
+	
+	cerr.rdbuf(cerr_buffer);
+	
+	csv_buffer out;
+	out << "benchmark,iterations,items,ns_per_item\n";
+	for(int i = 0; i < results.size(); i++)
+	{
+		out << results[i].name << "," << long(results[i].iterations) << ",";
+		out << results[i].items << "," << results[i].ns_per_item << "\n";
+	}
+	if(!out.save(results_file))
+	{
+		cerr << "could not write " << results_file << ".\n";
+		return 1;
+	}
+	return 0;
+}
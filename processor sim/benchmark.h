@@ -0,0 +1,28 @@
+/*
+ *  benchmark.h
+ *  processor
+ *
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct benchmark_result
+{
+	string name;
+	long long iterations;	// calls of the benchmark body
+	double items;			// operations per call
+	double ns_per_item;
+};
+
+// micro-benchmarks of the simulator hot paths, on fixtures built from the
+// landings file and from a synthetic fleet ten times its size; results go
+// to stdout and to results_file as CSV
+int run_benchmarks(const string & landings_file, const string & results_file, const double min_seconds);
+
+#endif
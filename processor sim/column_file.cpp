@@ -0,0 +1,358 @@
+/*
+ *  column_file.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "column_file.h"
+
+const char COLUMN_MAGIC[4] = {'C', 'O', 'L', 'F'};
+const int COLUMN_VERSION = 1;
+
+static size_t padded8(const size_t n)
+{
+	return (n + 7) / 8 * 8;
+}
+
+static void copy_name(char * dest, const size_t size, const string & name)
+{
+	memset(dest, 0, size);
+	strncpy(dest, name.c_str(), size - 1);
+	return;
+}
+
+column_file_builder::column_file_builder()
+{
+	year = 0;
+}
+
+column_file_builder::~column_file_builder()
+{
+}
+
+// start a new file; buffers keep their capacity
+void column_file_builder::clear(const int year)
+{
+	this->year = year;
+	tables.clear();
+	columns.clear();
+	data.clear();
+	return;
+}
+
+void column_file_builder::begin_table(const string & name, const int num_rows)
+{
+	column_table_entry table;
+	copy_name(table.name, sizeof(table.name), name);
+	table.num_rows = num_rows;
+	table.first_column = columns.size();
+	table.num_columns = 0;
+	table.reserved = 0;
+	tables.push_back(table);
+	return;
+}
+
+void column_file_builder::add_column(const string & name, const double * values)
+{
+	add_entry(name, COLUMN_DOUBLE, values, tables.back().num_rows * sizeof(double), NULL);
+	return;
+}
+
+void column_file_builder::add_column(const string & name, const int * values)
+{
+	add_entry(name, COLUMN_INT, values, tables.back().num_rows * sizeof(int), NULL);
+	return;
+}
+
+// strings are stored as codes into a dictionary of the distinct values, in
+// order of first appearance
+void column_file_builder::add_column(const string & name, const vector<string> & values)
+{
+	int num_rows = tables.back().num_rows;
+	vector<int> codes(num_rows);
+	vector<string> dictionary;
+	unordered_map<string, int> lookup;
+	for(int i = 0; i < num_rows; i++)
+	{
+		unordered_map<string, int>::iterator found = lookup.find(values[i]);
+		if(found == lookup.end())
+		{
+			found = lookup.insert(make_pair(values[i], int(dictionary.size()))).first;
+			dictionary.push_back(values[i]);
+		}
+		codes[i] = found->second;
+	}
+	add_entry(name, COLUMN_DICTIONARY, codes.data(), num_rows * sizeof(int), &dictionary);
+	return;
+}
+
+void column_file_builder::add_entry(const string & name, const int type, const void * values, const size_t size, 
+									const vector<string> * dictionary)
+{
+	column_entry column;
+	copy_name(column.name, sizeof(column.name), name);
+	column.type = type;
+	column.dict_count = 0;
+	column.offset = data.size();
+	column.dict_offset = 0;
+	data.append((const char *)values, size);
+	data.resize(padded8(data.size()), 0);
+	
+	if(dictionary != NULL)
+	{
+		int count = dictionary->size();
+		vector<int> offsets(count + 1);
+		offsets[0] = 0;
+		for(int i = 0; i < count; i++)
+			offsets[i + 1] = offsets[i] + (*dictionary)[i].length();
+		column.dict_count = count;
+		column.dict_offset = data.size();
+		data.append((const char *)offsets.data(), offsets.size() * sizeof(int));
+		for(int i = 0; i < count; i++)
+			data += (*dictionary)[i];
+		data.resize(padded8(data.size()), 0);
+	}
+	
+	columns.push_back(column);
+	tables.back().num_columns++;
+	return;
+}
+
+// assemble the file contents
+string column_file_builder::build()
+{
+	column_file_header header;
+	memcpy(header.magic, COLUMN_MAGIC, sizeof(header.magic));
+	header.version = COLUMN_VERSION;
+	header.year = year;
+	header.num_tables = tables.size();
+	header.num_columns = columns.size();
+	header.reserved = 0;
+	
+	size_t data_start = sizeof(header) + tables.size() * sizeof(column_table_entry) + 
+		columns.size() * sizeof(column_entry);
+	string contents;
+	contents.reserve(data_start + data.size());
+	contents.append((const char *)&header, sizeof(header));
+	contents.append((const char *)tables.data(), tables.size() * sizeof(column_table_entry));
+	for(int i = 0; i < columns.size(); i++)
+	{
+		column_entry column = columns[i];
+		column.offset += data_start;
+		if(column.type == COLUMN_DICTIONARY)
+			column.dict_offset += data_start;
+		contents.append((const char *)&column, sizeof(column));
+	}
+	contents += data;
+	return contents;
+}
+
+column_file_view::column_file_view()
+{
+	data = NULL;
+	length = 0;
+	header = NULL;
+}
+
+column_file_view::~column_file_view()
+{
+	close();
+}
+
+bool column_file_view::open(const string & filename)
+{
+	close();
+	
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+	
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size < sizeof(column_file_header))
+	{
+		::close(fd);
+		return false;
+	}
+	length = info.st_size;
+	data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+	{
+		data = NULL;
+		return false;
+	}
+	
+	const char * base = (const char *)data;
+	header = (const column_file_header *)base;
+	if(memcmp(header->magic, COLUMN_MAGIC, sizeof(header->magic)) != 0 || 
+	   header->version != COLUMN_VERSION || header->num_tables < 0 || header->num_columns < 0 || 
+	   sizeof(column_file_header) + header->num_tables * sizeof(column_table_entry) + 
+	   header->num_columns * sizeof(column_entry) > length)
+	{
+		cerr << filename << " is not a column file.\n";
+		close();
+		return false;
+	}
+	table_entries = (const column_table_entry *)(base + sizeof(column_file_header));
+	column_entries = (const column_entry *)(table_entries + header->num_tables);
+	if(!valid())
+	{
+		cerr << filename << " is truncated or damaged.\n";
+		close();
+		return false;
+	}
+	return true;
+}
+
+// every name is terminated, every column belongs to one table, and every
+// column's values, dictionary and codes lie inside the file
+bool column_file_view::valid() const
+{
+	const char * base = (const char *)data;
+	size_t data_start = sizeof(column_file_header) + header->num_tables * sizeof(column_table_entry) + 
+		header->num_columns * sizeof(column_entry);
+	vector<int> column_rows(header->num_columns, -1);
+	
+	for(int t = 0; t < header->num_tables; t++)
+	{
+		const column_table_entry & table = table_entries[t];
+		if(memchr(table.name, 0, sizeof(table.name)) == NULL || table.num_rows < 0 || 
+		   table.first_column < 0 || table.num_columns < 0 || 
+		   table.first_column > header->num_columns - table.num_columns)
+			return false;
+		for(int c = table.first_column; c < table.first_column + table.num_columns; c++)
+		{
+			if(column_rows[c] >= 0)
+				return false;
+			column_rows[c] = table.num_rows;
+		}
+	}
+	
+	for(int c = 0; c < header->num_columns; c++)
+	{
+		const column_entry & column = column_entries[c];
+		if(column_rows[c] < 0 || memchr(column.name, 0, sizeof(column.name)) == NULL)
+			return false;
+		
+		size_t value_size;
+		switch(column.type)
+		{
+			case COLUMN_DOUBLE:
+				value_size = sizeof(double);
+				break;
+			case COLUMN_INT:
+			case COLUMN_DICTIONARY:
+				value_size = sizeof(int);
+				break;
+			default:
+				return false;
+		}
+		if(column.offset < (long long)data_start || column.offset % 8 != 0 || 
+		   column.offset > (long long)length || 
+		   column_rows[c] * value_size > length - column.offset)
+			return false;
+		if(column.type != COLUMN_DICTIONARY)
+			continue;
+		
+		// offsets[dict_count + 1] must rise from 0 to the end of the characters
+		if(column.dict_count < 0 || column.dict_offset < (long long)data_start || column.dict_offset % 8 != 0 || 
+		   column.dict_offset > (long long)length || 
+		   (column.dict_count + 1) * sizeof(int) > length - column.dict_offset)
+			return false;
+		const int * offsets = (const int *)(base + column.dict_offset);
+		size_t chars_start = column.dict_offset + (column.dict_count + 1) * sizeof(int);
+		if(offsets[0] != 0)
+			return false;
+		for(int k = 0; k < column.dict_count; k++)
+		{
+			if(offsets[k + 1] < offsets[k])
+				return false;
+		}
+		if(offsets[column.dict_count] > length - chars_start)
+			return false;
+		
+		const int * codes = (const int *)(base + column.offset);
+		for(int i = 0; i < column_rows[c]; i++)
+		{
+			if(codes[i] < 0 || codes[i] >= column.dict_count)
+				return false;
+		}
+	}
+	return true;
+}
+
+void column_file_view::close()
+{
+	if(data != NULL)
+		munmap(data, length);
+	data = NULL;
+	length = 0;
+	header = NULL;
+	return;
+}
+
+int column_file_view::year() const
+{
+	return header->year;
+}
+
+int column_file_view::find_table(const string & name) const
+{
+	for(int t = 0; t < header->num_tables; t++)
+	{
+		if(name == table_entries[t].name)
+			return t;
+	}
+	return -1;
+}
+
+int column_file_view::num_rows(const int table) const
+{
+	return table_entries[table].num_rows;
+}
+
+int column_file_view::find_column(const int table, const string & name) const
+{
+	const column_table_entry & entry = table_entries[table];
+	for(int c = entry.first_column; c < entry.first_column + entry.num_columns; c++)
+	{
+		if(name == column_entries[c].name)
+			return c;
+	}
+	return -1;
+}
+
+int column_file_view::column_type(const int column) const
+{
+	return column_entries[column].type;
+}
+
+const double * column_file_view::doubles(const int column) const
+{
+	return (const double *)((const char *)data + column_entries[column].offset);
+}
+
+// the codes of a DICTIONARY column are read the same way
+const int * column_file_view::ints(const int column) const
+{
+	return (const int *)((const char *)data + column_entries[column].offset);
+}
+
+int column_file_view::dictionary_size(const int column) const
+{
+	return column_entries[column].dict_count;
+}
+
+string column_file_view::dictionary(const int column, const int code) const
+{
+	const int * offsets = (const int *)((const char *)data + column_entries[column].dict_offset);
+	const char * chars = (const char *)(offsets + column_entries[column].dict_count + 1);
+	return string(chars + offsets[code], offsets[code + 1] - offsets[code]);
+}
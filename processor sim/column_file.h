@@ -0,0 +1,111 @@
+/*
+ *  column_file.h
+ *  processor
+ *
+ */
+
+#ifndef COLUMN_FILE_H
+#define COLUMN_FILE_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// self-describing columnar result file, laid out so it can be mapped and
+// sliced in place:
+//   header, then num_tables table entries, then num_columns column entries,
+//   then the column data, each block starting on an 8 byte boundary.
+// DOUBLE and INT columns are plain arrays of num_rows values. DICTIONARY
+// columns are int codes[num_rows], with the dictionary stored at dict_offset
+// as int offsets[dict_count + 1] followed by the characters.
+enum ColumnType
+{
+	COLUMN_DOUBLE,
+	COLUMN_INT,
+	COLUMN_DICTIONARY
+};
+
+struct column_file_header
+{
+	char magic[4];
+	int version;
+	int year;
+	int num_tables;
+	int num_columns;
+	int reserved;
+};
+
+struct column_table_entry
+{
+	char name[24];
+	int num_rows;
+	int first_column;
+	int num_columns;
+	int reserved;
+};
+
+struct column_entry
+{
+	char name[32];
+	int type;
+	int dict_count;
+	long long offset;
+	long long dict_offset;
+};
+
+// builds a column file in memory, one table at a time
+class column_file_builder
+	{
+	public:
+		column_file_builder();
+		~column_file_builder();
+		
+		void clear(const int year);
+		void begin_table(const string & name, const int num_rows);
+		void add_column(const string & name, const double * values);
+		void add_column(const string & name, const int * values);
+		void add_column(const string & name, const vector<string> & values);
+		string build();
+		
+	private:
+		void add_entry(const string & name, const int type, const void * values, const size_t size, 
+					   const vector<string> * dictionary);
+		
+		int year;
+		vector<column_table_entry> tables;
+		vector<column_entry> columns;
+		string data;	// column data, offsets relative to its start until build()
+	};
+
+// read-only view of a column file mapped into memory
+class column_file_view
+	{
+	public:
+		column_file_view();
+		~column_file_view();
+		
+		bool open(const string & filename);
+		void close();
+		
+		int year() const;
+		int find_table(const string & name) const;
+		int num_rows(const int table) const;
+		int find_column(const int table, const string & name) const;
+		int column_type(const int column) const;
+		const double * doubles(const int column) const;
+		const int * ints(const int column) const;
+		int dictionary_size(const int column) const;
+		string dictionary(const int column, const int code) const;
+		
+	private:
+		bool valid() const;
+		
+		void * data;
+		size_t length;
+		const column_file_header * header;
+		const column_table_entry * table_entries;
+		const column_entry * column_entries;
+	};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ *  credit_factor_db.cpp
+ *  processor
+ *
+ */
+
+#include "credit_factor_db.h"
+
+credit_factor_db::credit_factor_db()
+{
+	clear();
+}
+
+credit_factor_db::~credit_factor_db()
+{
+}
+
+void credit_factor_db::clear()
+{
+	p_A.clear();
+	p_B.clear();
+	q_A.clear();
+	q_B.clear();
+	cim_A.clear();
+	cim_B.clear();
+	present.clear();
+	fingerprint = 0;
+	return;
+}
+
+void credit_factor_db::reserve(const int num_ids)
+{
+	p_A.reserve(num_ids);
+	p_B.reserve(num_ids);
+	q_A.reserve(num_ids);
+	q_B.reserve(num_ids);
+	cim_A.reserve(num_ids);
+	cim_B.reserve(num_ids);
+	present.reserve(num_ids);
+	return;
+}
+
+int credit_factor_db::size() const
+{
+	return present.size();
+}
+
+bool credit_factor_db::contains(const int id) const
+{
+	return id < present.size() && present[id];
+}
+
+void credit_factor_db::add(const int id)
+{
+	if(id >= present.size())
+		grow(id + 1);
+	
+	p_A[id] = 1;
+	p_B[id] = 1;
+	q_A[id] = 1;
+	q_B[id] = 1;
+	cim_A[id] = 1;
+	cim_B[id] = 1;
+	present[id] = true;
+	return;
+}
+
+void credit_factor_db::grow(const int num_ids)
+{
+	p_A.resize(num_ids, 1);
+	p_B.resize(num_ids, 1);
+	q_A.resize(num_ids, 1);
+	q_B.resize(num_ids, 1);
+	cim_A.resize(num_ids, 1);
+	cim_B.resize(num_ids, 1);
+	present.resize(num_ids, false);
+	return;
+}
@@ -0,0 +1,41 @@
+/*
+ *  credit_factor_db.h
+ *  processor
+ *
+ */
+
+#ifndef CREDIT_FACTOR_DB_H
+#define CREDIT_FACTOR_DB_H
+
+#include <vector>
+
+using namespace std;
+
+// credit factor state indexed by interned vessel id; the current values are
+// kept in flat arrays so a season update streams through them in order
+class credit_factor_db
+	{
+	public:
+		credit_factor_db();
+		~credit_factor_db();
+		
+		void clear();
+		void reserve(const int num_ids);
+		int size() const;
+		bool contains(const int id) const;
+		void add(const int id);
+		
+		// current values
+		vector<double> p_A, p_B;
+		vector<double> q_A, q_B;
+		vector<double> cim_A, cim_B;
+		vector<char> present;
+		
+		// of the policy parameters of every year that led to these values
+		unsigned long long fingerprint;
+		
+	private:
+		void grow(const int num_ids);
+	};
+
+#endif
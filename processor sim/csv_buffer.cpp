@@ -0,0 +1,108 @@
+/*
+ *  csv_buffer.cpp
+ *  processor
+ *
+ */
+
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include "csv_buffer.h"
+
+// long enough for any double or 64-bit integer
+const int MAX_FIELD = 32;
+
+csv_buffer::csv_buffer(const size_t reserve)
+{
+	buffer.reserve(reserve);
+}
+
+csv_buffer::~csv_buffer()
+{
+}
+
+csv_buffer & csv_buffer::operator <<(const double value)
+{
+	// spelled the way iostream spells them
+	if(isnan(value))
+	{
+		buffer += signbit(value) ? "-nan" : "nan";
+		return *this;
+	}
+	char field[MAX_FIELD];
+	to_chars_result result = to_chars(field, field + MAX_FIELD, value);
+	buffer.append(field, result.ptr - field);
+	return *this;
+}
+
+csv_buffer & csv_buffer::operator <<(const int value)
+{
+	char field[MAX_FIELD];
+	to_chars_result result = to_chars(field, field + MAX_FIELD, value);
+	buffer.append(field, result.ptr - field);
+	return *this;
+}
+
+csv_buffer & csv_buffer::operator <<(const long value)
+{
+	char field[MAX_FIELD];
+	to_chars_result result = to_chars(field, field + MAX_FIELD, value);
+	buffer.append(field, result.ptr - field);
+	return *this;
+}
+
+csv_buffer & csv_buffer::operator <<(const unsigned long value)
+{
+	char field[MAX_FIELD];
+	to_chars_result result = to_chars(field, field + MAX_FIELD, value);
+	buffer.append(field, result.ptr - field);
+	return *this;
+}
+
+csv_buffer & csv_buffer::operator <<(const char value)
+{
+	buffer += value;
+	return *this;
+}
+
+csv_buffer & csv_buffer::operator <<(const char * value)
+{
+	buffer += value;
+	return *this;
+}
+
+csv_buffer & csv_buffer::operator <<(const string & value)
+{
+	buffer += value;
+	return *this;
+}
+
+const string & csv_buffer::str() const
+{
+	return buffer;
+}
+
+// hand over the contents, leaving the buffer empty
+string csv_buffer::take()
+{
+	string contents;
+	contents.swap(buffer);
+	return contents;
+}
+
+void csv_buffer::clear()
+{
+	buffer.clear();
+	return;
+}
+
+bool csv_buffer::save(const string & filename) const
+{
+	ofstream out;
+	out.open(filename.c_str(), ios::out | ios::binary);
+	if(!out.is_open())
+		return false;
+	out.write(buffer.data(), buffer.size());
+	out.close();
+	return bool(out);
+}
@@ -0,0 +1,40 @@
+/*
+ *  csv_buffer.h
+ *  processor
+ *
+ */
+
+#ifndef CSV_BUFFER_H
+#define CSV_BUFFER_H
+
+#include <string>
+
+using namespace std;
+
+// in-memory text output for the CSV writers; numbers are formatted with
+// to_chars, doubles in the shortest form that reads back to the same value,
+// so nothing goes through the iostream locale machinery
+class csv_buffer
+	{
+	public:
+		csv_buffer(const size_t reserve = 1 << 16);
+		~csv_buffer();
+		
+		csv_buffer & operator <<(const double value);
+		csv_buffer & operator <<(const int value);
+		csv_buffer & operator <<(const long value);
+		csv_buffer & operator <<(const unsigned long value);
+		csv_buffer & operator <<(const char value);
+		csv_buffer & operator <<(const char * value);
+		csv_buffer & operator <<(const string & value);
+		
+		const string & str() const;
+		string take();
+		void clear();
+		bool save(const string & filename) const;
+		
+	private:
+		string buffer;
+	};
+
+#endif
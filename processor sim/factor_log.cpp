@@ -0,0 +1,179 @@
+/*
+ *  factor_log.cpp
+ *  processor
+ *
+ */
+
+#include "factor_log.h"
+#include "csv_buffer.h"
+
+// record tags
+const char RUN_RECORD = 'R';
+const char NAME_RECORD = 'N';
+const char FACTOR_RECORD = 'F';
+
+static void write_string(ofstream & out, const string & value)
+{
+	int length = value.length();
+	out.write((const char *)&length, sizeof(length));
+	out.write(value.data(), length);
+}
+
+static bool read_string(ifstream & in, string & value)
+{
+	int length;
+	if(!in.read((char *)&length, sizeof(length)) || length < 0)
+		return false;
+	value.resize(length);
+	return length == 0 || in.read(&value[0], length);
+}
+
+factor_log::factor_log()
+{
+}
+
+factor_log::~factor_log()
+{
+	close();
+}
+
+bool factor_log::open(const string & filename)
+{
+	close();
+	out.open(filename.c_str(), ios::out | ios::binary | ios::app);
+	named.clear();
+	if(!out.is_open())
+		return false;
+	out.put(RUN_RECORD);
+	return bool(out);
+}
+
+void factor_log::close()
+{
+	if(out.is_open())
+		out.close();
+	return;
+}
+
+bool factor_log::is_open() const
+{
+	return out.is_open();
+}
+
+void factor_log::append(const factor_log_record & record, const string & name, const string & coop)
+{
+	if(record.vessel_id >= named.size())
+		named.resize(record.vessel_id + 1, false);
+	if(!named[record.vessel_id])
+	{
+		out.put(NAME_RECORD);
+		out.write((const char *)&record.vessel_id, sizeof(record.vessel_id));
+		write_string(out, name);
+		write_string(out, coop);
+		named[record.vessel_id] = true;
+	}
+	
+	// fields are written one at a time so the file has no struct padding
+	out.put(FACTOR_RECORD);
+	out.write((const char *)&record.year, sizeof(record.year));
+	out.write((const char *)&record.vessel_id, sizeof(record.vessel_id));
+	out.put(record.season);
+	out.write((const char *)&record.p, sizeof(record.p));
+	out.write((const char *)&record.q, sizeof(record.q));
+	out.write((const char *)&record.cim, sizeof(record.cim));
+	return;
+}
+
+bool read_factor_log(const string & filename, vector<factor_log_record> & records, 
+					 vector<string> & names, vector<string> & coops)
+{
+	ifstream in;
+	in.open(filename.c_str(), ios::in | ios::binary);
+	if(!in.is_open())
+		return false;
+	
+	records.clear();
+	names.clear();
+	coops.clear();
+	
+	// names of the current run's vessels, by id; a log written before run
+	// records were added is one run
+	vector<string> run_names, run_coops;
+	factor_log_record record;
+	record.run = 0;
+	bool run_started = false;
+	int id;
+	char tag;
+	while(in.get(tag))
+	{
+		switch(tag)
+		{
+			case RUN_RECORD:
+				if(run_started)
+					record.run++;
+				run_started = true;
+				run_names.clear();
+				run_coops.clear();
+				break;
+			case NAME_RECORD:
+				run_started = true;
+				if(!in.read((char *)&id, sizeof(id)) || id < 0)
+					return false;
+				if(id >= run_names.size())
+				{
+					run_names.resize(id + 1);
+					run_coops.resize(id + 1);
+				}
+				if(!read_string(in, run_names[id]) || !read_string(in, run_coops[id]))
+					return false;
+				break;
+			case FACTOR_RECORD:
+				run_started = true;
+				in.read((char *)&record.year, sizeof(record.year));
+				in.read((char *)&record.vessel_id, sizeof(record.vessel_id));
+				in.get(record.season);
+				in.read((char *)&record.p, sizeof(record.p));
+				in.read((char *)&record.q, sizeof(record.q));
+				if(!in.read((char *)&record.cim, sizeof(record.cim)))
+					return false;
+				records.push_back(record);
+				id = record.vessel_id;
+				names.push_back(id >= 0 && id < run_names.size() ? run_names[id] : string());
+				coops.push_back(id >= 0 && id < run_coops.size() ? run_coops[id] : string());
+				break;
+			default:
+				cerr << "unexpected record in " << filename << ".\n";
+				return false;
+		}
+	}
+	return true;
+}
+
+void print_factor_log(const string & log_filename, const string & csv_filename)
+{
+	vector<factor_log_record> records;
+	vector<string> names, coops;
+	if(!read_factor_log(log_filename, records, names, coops))
+		cerr << "could not read all of " << log_filename << ".\n";
+	
+	csv_buffer out;
+	
+	// header row
+	out << "Run,Year,Vessel Name,Coop,Season,Credit Factor,q-value,Chinook Multiplier\n";
+	
+	int num_records = records.size();
+	for(int i = 0; i < num_records; i++)
+	{
+		out << records[i].run << ",";
+		out << records[i].year << ",";
+		out << names[i] << ",";
+		out << coops[i] << ",";
+		out << records[i].season << ",";
+		out << records[i].p << ",";
+		out << records[i].q << ",";
+		out << records[i].cim << "\n";
+	}
+	if(!out.save(csv_filename))
+		cerr << "could not write " << csv_filename << ".\n";
+	return;
+}
@@ -0,0 +1,53 @@
+/*
+ *  factor_log.h
+ *  processor
+ *
+ */
+
+#ifndef FACTOR_LOG_H
+#define FACTOR_LOG_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+
+using namespace std;
+
+struct factor_log_record
+{
+	int run;		// counted from 0 in the order the runs were logged; set when reading
+	int year;
+	int vessel_id;
+	char season;	// 'A' or 'B'
+	double p;		// credit factor going into the season
+	double q;		// penalty value earned in the season
+	double cim;		// chinook multiplier after the season
+};
+
+// append-only binary log of the per-year credit factor values. Each open()
+// starts a run with a header record, and within a run each vessel's name and
+// coop are written once, ahead of its first factor record; vessel ids are only
+// meaningful within their run, since other landings intern them in another order
+class factor_log
+	{
+	public:
+		factor_log();
+		~factor_log();
+		
+		bool open(const string & filename);
+		void close();
+		bool is_open() const;
+		void append(const factor_log_record & record, const string & name, const string & coop);
+		
+	private:
+		ofstream out;
+		vector<char> named;
+	};
+
+// names[i] and coops[i] are those of records[i]'s vessel in its run
+bool read_factor_log(const string & filename, vector<factor_log_record> & records, 
+					 vector<string> & names, vector<string> & coops);
+void print_factor_log(const string & log_filename, const string & csv_filename);
+
+#endif
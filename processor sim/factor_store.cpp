@@ -0,0 +1,155 @@
+/*
+ *  factor_store.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "factor_store.h"
+
+const char STORE_MAGIC[4] = {'C', 'F', 'D', 'B'};
+const int STORE_VERSION = 2;
+
+static size_t padded(const size_t n)
+{
+	return (n + 3) / 4 * 4;
+}
+
+bool save_factor_store(const string & filename, const int year, 
+					   const credit_factor_db & factor_DB, const vector<string> & keys)
+{
+	int num_slots = factor_DB.size();
+	
+	vector<int> key_offsets(num_slots + 1);
+	key_offsets[0] = 0;
+	for(int i = 0; i < num_slots; i++)
+		key_offsets[i + 1] = key_offsets[i] + keys[i].length();
+	
+	factor_store_header header;
+	memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+	header.version = STORE_VERSION;
+	header.year = year;
+	header.num_slots = num_slots;
+	header.keys_size = key_offsets[num_slots];
+	header.reserved = 0;
+	header.fingerprint = factor_DB.fingerprint;
+	
+	ofstream out;
+	out.open(filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if(!out.is_open())
+		return false;
+	
+	out.write((const char *)&header, sizeof(header));
+	out.write((const char *)factor_DB.p_A.data(), num_slots * sizeof(double));
+	out.write((const char *)factor_DB.p_B.data(), num_slots * sizeof(double));
+	out.write((const char *)factor_DB.q_A.data(), num_slots * sizeof(double));
+	out.write((const char *)factor_DB.q_B.data(), num_slots * sizeof(double));
+	out.write((const char *)factor_DB.cim_A.data(), num_slots * sizeof(double));
+	out.write((const char *)factor_DB.cim_B.data(), num_slots * sizeof(double));
+	out.write(factor_DB.present.data(), num_slots);
+	for(size_t i = num_slots; i < padded(num_slots); i++)
+		out.put(0);
+	out.write((const char *)key_offsets.data(), key_offsets.size() * sizeof(int));
+	for(int i = 0; i < num_slots; i++)
+		out.write(keys[i].data(), keys[i].length());
+	
+	out.close();
+	return !out.fail();
+}
+
+factor_store_view::factor_store_view()
+{
+	data = NULL;
+	length = 0;
+	header = NULL;
+}
+
+factor_store_view::~factor_store_view()
+{
+	close();
+}
+
+bool factor_store_view::open(const string & filename)
+{
+	close();
+	
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+	
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size < sizeof(factor_store_header))
+	{
+		::close(fd);
+		return false;
+	}
+	length = info.st_size;
+	data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+	{
+		data = NULL;
+		return false;
+	}
+	
+	const char * base = (const char *)data;
+	header = (const factor_store_header *)base;
+	int n = header->num_slots;
+	size_t keys_start = sizeof(factor_store_header) + 6 * n * sizeof(double) + padded(n);
+	if(memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0 || 
+	   header->version != STORE_VERSION || n < 0 || 
+	   keys_start + (n + 1) * sizeof(int) + header->keys_size != length)
+	{
+		cerr << filename << " is not a credit factor store.\n";
+		close();
+		return false;
+	}
+	
+	const double * arrays = (const double *)(base + sizeof(factor_store_header));
+	p_A = arrays;
+	p_B = arrays + n;
+	q_A = arrays + 2 * n;
+	q_B = arrays + 3 * n;
+	cim_A = arrays + 4 * n;
+	cim_B = arrays + 5 * n;
+	present = (const char *)(arrays + 6 * n);
+	key_offsets = (const int *)(base + keys_start);
+	key_chars = (const char *)(key_offsets + n + 1);
+	return true;
+}
+
+void factor_store_view::close()
+{
+	if(data != NULL)
+		munmap(data, length);
+	data = NULL;
+	length = 0;
+	header = NULL;
+	return;
+}
+
+int factor_store_view::year() const
+{
+	return header->year;
+}
+
+unsigned long long factor_store_view::fingerprint() const
+{
+	return header->fingerprint;
+}
+
+int factor_store_view::size() const
+{
+	return header->num_slots;
+}
+
+string factor_store_view::key(const int slot) const
+{
+	return string(key_chars + key_offsets[slot], key_offsets[slot + 1] - key_offsets[slot]);
+}
@@ -0,0 +1,66 @@
+/*
+ *  factor_store.h
+ *  processor
+ *
+ */
+
+#ifndef FACTOR_STORE_H
+#define FACTOR_STORE_H
+
+#include <string>
+#include <vector>
+#include "credit_factor_db.h"
+
+using namespace std;
+
+// one file per year holding the credit factor state after that year and the
+// fingerprint of the policy parameters that led to it:
+//   header, then p_A, p_B, q_A, q_B, cim_A, cim_B as double[num_slots],
+//   present as char[num_slots] padded to 4 bytes, then the vessel keys
+//   ("name,coop") as int offsets[num_slots + 1] followed by the characters
+struct factor_store_header
+{
+	char magic[4];
+	int version;
+	int year;
+	int num_slots;
+	int keys_size;
+	int reserved;
+	unsigned long long fingerprint;
+};
+
+bool save_factor_store(const string & filename, const int year, 
+					   const credit_factor_db & factor_DB, const vector<string> & keys);
+
+// read-only view of a store file mapped into memory
+class factor_store_view
+	{
+	public:
+		factor_store_view();
+		~factor_store_view();
+		
+		bool open(const string & filename);
+		void close();
+		
+		int year() const;
+		unsigned long long fingerprint() const;
+		int size() const;
+		string key(const int slot) const;
+		
+		const double * p_A;
+		const double * p_B;
+		const double * q_A;
+		const double * q_B;
+		const double * cim_A;
+		const double * cim_B;
+		const char * present;
+		
+	private:
+		void * data;
+		size_t length;
+		const factor_store_header * header;
+		const int * key_offsets;
+		const char * key_chars;
+	};
+
+#endif
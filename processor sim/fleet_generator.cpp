@@ -0,0 +1,405 @@
+/*
+ *  fleet_generator.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include "fleet_generator.h"
+#include "csv_buffer.h"
+#include "column_file.h"
+
+// spread of the per-vessel bycatch level around the vessel it follows
+const double VESSEL_RATE_SD = 0.3;
+
+// the A season runs to June 10
+static bool a_season(const int month, const int day)
+{
+	return month < 6 || (month == 6 && day < 11);
+}
+
+static unsigned long long rotate_left(const unsigned long long x, const int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+random_stream::random_stream(const unsigned long long seed)
+{
+	unsigned long long x = seed;
+	for(int i = 0; i < 4; i++)
+	{
+		x += 0x9e3779b97f4a7c15ULL;
+		unsigned long long z = x;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		state[i] = z ^ (z >> 31);
+	}
+}
+
+unsigned long long random_stream::next()
+{
+	unsigned long long result = rotate_left(state[1] * 5, 7) * 9;
+	unsigned long long t = state[1] << 17;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotate_left(state[3], 45);
+	return result;
+}
+
+double random_stream::uniform()
+{
+	return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Box-Muller, one value per call
+double random_stream::normal()
+{
+	double u = 1.0 - uniform();
+	double v = uniform();
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+int random_stream::below(const int n)
+{
+	return int(uniform() * n);
+}
+
+// Knuth's method for small means, a rounded normal for large ones
+int random_stream::poisson(const double mean)
+{
+	if(mean <= 0)
+		return 0;
+	if(mean > 50)
+		return max(0, int(floor(mean + sqrt(mean) * normal() + 0.5)));
+	double limit = exp(-mean);
+	double product = uniform();
+	int count = 0;
+	while(product > limit)
+	{
+		product *= uniform();
+		count++;
+	}
+	return count;
+}
+
+fleet_generator::fleet_generator()
+{
+	first_year = 0;
+	num_years = 0;
+}
+
+bool fleet_generator::fit(const vector<landing> & landings)
+{
+	profiles.clear();
+	if(landings.empty())
+		return false;
+	
+	first_year = landings[0].year;
+	int last_year = first_year;
+	for(int i = 0; i < landings.size(); i++)
+	{
+		first_year = min(first_year, landings[i].year);
+		last_year = max(last_year, landings[i].year);
+	}
+	num_years = last_year - first_year + 1;
+	
+	// bycatch moves a lot from season to season, so chinook is fitted as a
+	// season level plus an offset for each vessel
+	int num_periods = num_years * 2;
+	vector<double> period_sum(num_periods, 0), period_sq(num_periods, 0);
+	vector<int> period_hauls(num_periods, 0), period_positive(num_periods, 0);
+	vector<int> period(landings.size()), vessel_index(landings.size());
+	vector<double> sum_log_pollock, sum_sq_log_pollock;
+	vector<int> num_hauls;
+	unordered_map<string, int> index;
+	for(int i = 0; i < landings.size(); i++)
+	{
+		const landing & l = landings[i];
+		string key = l.name + "," + l.coop;
+		unordered_map<string, int>::iterator found = index.find(key);
+		int v;
+		if(found == index.end())
+		{
+			v = profiles.size();
+			index[key] = v;
+			vessel_profile profile;
+			profile.name = l.name;
+			profile.coop = l.coop;
+			profile.haul_dates.resize(num_years);
+			profiles.push_back(profile);
+			sum_log_pollock.push_back(0);
+			sum_sq_log_pollock.push_back(0);
+			num_hauls.push_back(0);
+		}
+		else
+			v = found->second;
+		vessel_index[i] = v;
+		period[i] = (l.year - first_year) * 2 + (a_season(l.month, l.day) ? 0 : 1);
+		
+		profiles[v].haul_dates[l.year - first_year].push_back(l.month * 32 + l.day);
+		if(l.pollock <= 0)
+			continue;
+		double log_pollock = log(l.pollock);
+		sum_log_pollock[v] += log_pollock;
+		sum_sq_log_pollock[v] += log_pollock * log_pollock;
+		num_hauls[v]++;
+		period_hauls[period[i]]++;
+		if(l.chinook > 0)
+		{
+			double log_rate = log(l.chinook / l.pollock);
+			period_sum[period[i]] += log_rate;
+			period_sq[period[i]] += log_rate * log_rate;
+			period_positive[period[i]]++;
+		}
+	}
+	
+	period_zero_chinook.assign(num_periods, 1);
+	period_log_rate_mean.assign(num_periods, log(0.01));
+	period_log_rate_sd.assign(num_periods, 1);
+	for(int t = 0; t < num_periods; t++)
+	{
+		int k = period_positive[t];
+		if(period_hauls[t] > 0)
+			period_zero_chinook[t] = 1.0 - double(k) / period_hauls[t];
+		if(k > 0)
+			period_log_rate_mean[t] = period_sum[t] / k;
+		if(k > 1)
+			period_log_rate_sd[t] = sqrt(max(0.0, period_sq[t] / k - period_log_rate_mean[t] * period_log_rate_mean[t]));
+	}
+	
+	// each vessel against the seasons it fished
+	vector<double> offset_sum(profiles.size(), 0), expected_zero(profiles.size(), 0);
+	vector<int> num_positive(profiles.size(), 0), num_zero(profiles.size(), 0);
+	for(int i = 0; i < landings.size(); i++)
+	{
+		const landing & l = landings[i];
+		int v = vessel_index[i];
+		if(l.pollock <= 0)
+			continue;
+		expected_zero[v] += period_zero_chinook[period[i]];
+		if(l.chinook > 0)
+		{
+			offset_sum[v] += log(l.chinook / l.pollock) - period_log_rate_mean[period[i]];
+			num_positive[v]++;
+		}
+		else
+			num_zero[v]++;
+	}
+	
+	for(int v = 0; v < profiles.size(); v++)
+	{
+		vessel_profile & profile = profiles[v];
+		int n = num_hauls[v];
+		profile.log_pollock_mean = n > 0 ? sum_log_pollock[v] / n : 0;
+		profile.log_pollock_sd = n > 1 ? 
+			sqrt(max(0.0, sum_sq_log_pollock[v] / n - profile.log_pollock_mean * profile.log_pollock_mean)) : 0;
+		profile.zero_chinook_ratio = expected_zero[v] > 0 ? num_zero[v] / expected_zero[v] : 1;
+		profile.log_rate_offset = num_positive[v] > 0 ? offset_sum[v] / num_positive[v] : 0;
+	}
+	return true;
+}
+
+// scale vessels per real vessel, each fishing on the days of the vessel it
+// follows (drawn with replacement), so the seasons keep their shape
+void fleet_generator::generate(const int scale, const unsigned long long seed, vector<landing> & landings) const
+{
+	random_stream random(seed);
+	landing haul;
+	char name[64], ticket[32];
+	int ticket_number = 0;
+	
+	landings.clear();
+	haul.vessel_id = 0;
+	for(int v = 0; v < profiles.size(); v++)
+	{
+		const vessel_profile & profile = profiles[v];
+		for(int copy = 0; copy < scale; copy++)
+		{
+			sprintf(name, "%s S%d", profile.name.c_str(), copy);
+			haul.name = name;
+			haul.coop = profile.coop;
+			double log_rate_offset = profile.log_rate_offset + VESSEL_RATE_SD * random.normal();
+			
+			for(int y = 0; y < num_years; y++)
+			{
+				const vector<int> & dates = profile.haul_dates[y];
+				if(dates.empty())
+					continue;
+				int year = first_year + y;
+				int num_hauls = random.poisson(dates.size());
+				for(int h = 0; h < num_hauls; h++)
+				{
+					int date = dates[random.below(dates.size())];
+					haul.year = year;
+					haul.month = date / 32;
+					haul.day = date % 32;
+					sprintf(ticket, "S%08d", ticket_number++);
+					haul.ticketNumber = ticket;
+					haul.pollock = exp(profile.log_pollock_mean + profile.log_pollock_sd * random.normal());
+					int t = y * 2 + (a_season(haul.month, haul.day) ? 0 : 1);
+					double log_rate = period_log_rate_mean[t] + log_rate_offset + period_log_rate_sd[t] * random.normal();
+					if(random.uniform() < period_zero_chinook[t] * profile.zero_chinook_ratio)
+						haul.chinook = 0;
+					else
+						haul.chinook = floor(haul.pollock * exp(log_rate) + 0.5);
+					landings.push_back(haul);
+				}
+			}
+		}
+	}
+	
+	// the simulator replays hauls in date order
+	stable_sort(landings.begin(), landings.end(), [](const landing & a, const landing & b) {
+		if(a.year != b.year)
+			return a.year < b.year;
+		if(a.month != b.month)
+			return a.month < b.month;
+		return a.day < b.day;
+	});
+	return;
+}
+
+int fleet_generator::num_profiles() const
+{
+	return profiles.size();
+}
+
+// appends the landings to out in the layout of cv_sector_data.csv, header first
+static void fill_landings_csv(csv_buffer & out, const vector<landing> & landings)
+{
+	out << "Year,ActivityDate,FishTicketN,Vessel,Coop,Season,Pollock,Chinook\n";
+	for(int i = 0; i < landings.size(); i++)
+	{
+		const landing & l = landings[i];
+		out << l.year << ",";
+		out << l.month << "/" << l.day << "/" << (l.year % 100 < 10 ? "0" : "") << l.year % 100 << ",";
+		out << l.ticketNumber << ",";
+		out << l.name << ",";
+		out << l.coop << ",";
+		out << (a_season(l.month, l.day) ? "A" : "B") << ",";
+		out << l.pollock << ",";
+		out << l.chinook << "\n";
+	}
+	return;
+}
+
+string landings_csv(const vector<landing> & landings)
+{
+	csv_buffer out(landings.size() * 80);
+	fill_landings_csv(out, landings);
+	return out.take();
+}
+
+bool write_landings_csv(const string & filename, const vector<landing> & landings)
+{
+	csv_buffer out(landings.size() * 80);
+	fill_landings_csv(out, landings);
+	return out.save(filename);
+}
+
+// a "landings" table in a column file
+bool write_landings_columns(const string & filename, const vector<landing> & landings)
+{
+	int n = landings.size();
+	vector<int> years(n), months(n), days(n);
+	vector<double> pollock(n), chinook(n);
+	vector<string> names(n), coops(n), tickets(n);
+	for(int i = 0; i < n; i++)
+	{
+		years[i] = landings[i].year;
+		months[i] = landings[i].month;
+		days[i] = landings[i].day;
+		pollock[i] = landings[i].pollock;
+		chinook[i] = landings[i].chinook;
+		names[i] = landings[i].name;
+		coops[i] = landings[i].coop;
+		tickets[i] = landings[i].ticketNumber;
+	}
+	
+	column_file_builder builder;
+	builder.clear(n > 0 ? years[0] : 0);
+	builder.begin_table("landings", n);
+	builder.add_column("year", years.data());
+	builder.add_column("month", months.data());
+	builder.add_column("day", days.data());
+	builder.add_column("ticket", tickets);
+	builder.add_column("vessel", names);
+	builder.add_column("coop", coops);
+	builder.add_column("pollock", pollock.data());
+	builder.add_column("chinook", chinook.data());
+	
+	csv_buffer out(0);
+	out << builder.build();
+	return out.save(filename);
+}
+
+bool read_landings_columns(const string & filename, vector<landing> & landings)
+{
+	column_file_view view;
+	if(!view.open(filename))
+		return false;
+	int table = view.find_table("landings");
+	if(table < 0)
+	{
+		cerr << filename << " has no landings table.\n";
+		return false;
+	}
+	
+	const char * column_names[8] = {"year", "month", "day", "ticket", "vessel", "coop", "pollock", "chinook"};
+	const int column_types[8] = {COLUMN_INT, COLUMN_INT, COLUMN_INT, COLUMN_DICTIONARY, COLUMN_DICTIONARY, 
+		COLUMN_DICTIONARY, COLUMN_DOUBLE, COLUMN_DOUBLE};
+	int columns[8];
+	for(int c = 0; c < 8; c++)
+	{
+		columns[c] = view.find_column(table, column_names[c]);
+		if(columns[c] < 0)
+		{
+			cerr << filename << " has no " << column_names[c] << " column.\n";
+			return false;
+		}
+		if(view.column_type(columns[c]) != column_types[c])
+		{
+			cerr << filename << ": the " << column_names[c] << " column has the wrong type.\n";
+			return false;
+		}
+	}
+	
+	int n = view.num_rows(table);
+	const int * years = view.ints(columns[0]);
+	const int * months = view.ints(columns[1]);
+	const int * days = view.ints(columns[2]);
+	const int * tickets = view.ints(columns[3]);
+	const int * names = view.ints(columns[4]);
+	const int * coops = view.ints(columns[5]);
+	const double * pollock = view.doubles(columns[6]);
+	const double * chinook = view.doubles(columns[7]);
+	
+	// decode each dictionary once
+	vector<string> name_values(view.dictionary_size(columns[4]));
+	vector<string> coop_values(view.dictionary_size(columns[5]));
+	for(int k = 0; k < name_values.size(); k++)
+		name_values[k] = view.dictionary(columns[4], k);
+	for(int k = 0; k < coop_values.size(); k++)
+		coop_values[k] = view.dictionary(columns[5], k);
+	
+	landings.resize(n);
+	for(int i = 0; i < n; i++)
+	{
+		landings[i].year = years[i];
+		landings[i].month = months[i];
+		landings[i].day = days[i];
+		landings[i].ticketNumber = view.dictionary(columns[3], tickets[i]);
+		landings[i].name = name_values[names[i]];
+		landings[i].coop = coop_values[coops[i]];
+		landings[i].vessel_id = 0;
+		landings[i].pollock = pollock[i];
+		landings[i].chinook = chinook[i];
+	}
+	return true;
+}
@@ -0,0 +1,71 @@
+/*
+ *  fleet_generator.h
+ *  processor
+ *
+ */
+
+#ifndef FLEET_GENERATOR_H
+#define FLEET_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include "simulator.h"
+
+using namespace std;
+
+// xoshiro256** seeded through splitmix64; the sequence for a seed is the same
+// on every platform, unlike the standard library distributions
+class random_stream
+	{
+	public:
+		random_stream(const unsigned long long seed);
+		
+		unsigned long long next();
+		double uniform();		// [0, 1)
+		double normal();
+		int below(const int n);	// 0 .. n-1
+		int poisson(const double mean);
+		
+	private:
+		unsigned long long state[4];
+	};
+
+// what the generator keeps about each real vessel
+struct vessel_profile
+{
+	string name;
+	string coop;
+	double log_pollock_mean, log_pollock_sd;	// haul size
+	double zero_chinook_ratio;					// hauls with no chinook, against the fleet
+	double log_rate_offset;						// chinook per ton, against the fleet
+	vector<vector<int> > haul_dates;			// month * 32 + day of every haul, by year offset
+};
+
+// fits per-vessel haul frequency, haul size and chinook distributions from
+// real landings and generates statistically similar fleets of any size; each
+// generated vessel follows a real one, with its own bycatch level
+class fleet_generator
+	{
+	public:
+		fleet_generator();
+		
+		bool fit(const vector<landing> & landings);
+		void generate(const int scale, const unsigned long long seed, vector<landing> & landings) const;
+		
+		int num_profiles() const;
+		
+	private:
+		vector<vessel_profile> profiles;
+		int first_year, num_years;
+		
+		// by season, A then B for each year
+		vector<double> period_zero_chinook;
+		vector<double> period_log_rate_mean, period_log_rate_sd;
+	};
+
+string landings_csv(const vector<landing> & landings);
+bool write_landings_csv(const string & filename, const vector<landing> & landings);
+bool write_landings_columns(const string & filename, const vector<landing> & landings);
+bool read_landings_columns(const string & filename, vector<landing> & landings);
+
+#endif
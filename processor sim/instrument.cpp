@@ -0,0 +1,105 @@
+/*
+ *  instrument.cpp
+ *  processor
+ *
+ */
+
+#include "instrument.h"
+
+#ifdef INSTRUMENT
+
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include "csv_buffer.h"
+#include "alloc_counter.h"
+
+// slots are never moved, so they can be updated without taking the lock
+const int MAX_PROFILE_SLOTS = 128;
+
+struct profile_slot
+{
+	const char * name;
+	ProfileKind kind;
+	atomic<long long> calls;
+	atomic<long long> total;	// nanoseconds for timers
+};
+
+static profile_slot slots[MAX_PROFILE_SLOTS];
+static int num_slots = 0;
+static mutex slots_lock;
+
+// called once per call site; a name used at several sites shares one slot
+int profile_register(const char * name, const ProfileKind kind)
+{
+	lock_guard<mutex> guard(slots_lock);
+	for(int i = 0; i < num_slots; i++)
+	{
+		if(slots[i].kind == kind && string(slots[i].name) == name)
+			return i;
+	}
+	if(num_slots == MAX_PROFILE_SLOTS)
+	{
+		cerr << "too many profile slots, " << name << " is not recorded.\n";
+		return MAX_PROFILE_SLOTS - 1;
+	}
+	slots[num_slots].name = name;
+	slots[num_slots].kind = kind;
+	return num_slots++;
+}
+
+void profile_add(const int slot, const long long amount)
+{
+	slots[slot].calls.fetch_add(1, memory_order_relaxed);
+	slots[slot].total.fetch_add(amount, memory_order_relaxed);
+	return;
+}
+
+void profile_add_time(const int slot, const long long nanoseconds)
+{
+	profile_add(slot, nanoseconds);
+	return;
+}
+
+void profile_report(const string & prefix, const char * name)
+{
+	// the report, file name included, is not part of the run, so it does not
+	// count against the -verify steady-state allocation gate
+	bool counting = allocation_counting();
+	set_allocation_counting(false);
+	
+	lock_guard<mutex> guard(slots_lock);
+	string filename = prefix + name;
+	csv_buffer out;
+	
+	out << "{\n  \"timers\": {";
+	bool first = true;
+	for(int i = 0; i < num_slots; i++)
+	{
+		if(slots[i].kind != PROFILE_TIMER)
+			continue;
+		out << (first ? "\n" : ",\n") << "    \"" << slots[i].name << "\": {\"calls\": ";
+		out << long(slots[i].calls.exchange(0)) << ", \"seconds\": ";
+		out << slots[i].total.exchange(0) * 1e-9 << "}";
+		first = false;
+	}
+	out << "\n  },\n  \"counters\": {";
+	first = true;
+	for(int i = 0; i < num_slots; i++)
+	{
+		if(slots[i].kind != PROFILE_COUNTER)
+			continue;
+		out << (first ? "\n" : ",\n") << "    \"" << slots[i].name << "\": {\"events\": ";
+		out << long(slots[i].calls.exchange(0)) << ", \"total\": ";
+		out << long(slots[i].total.exchange(0)) << "}";
+		first = false;
+	}
+	out << "\n  }\n}\n";
+	
+	if(!out.save(filename))
+		cerr << "could not write " << filename << ".\n";
+	set_allocation_counting(counting);
+	return;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ *  instrument.h
+ *  processor
+ *
+ */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// phase timers and event counters, compiled in only when INSTRUMENT is
+// defined; otherwise every macro expands to nothing.
+//   PROFILE_SCOPE("name")		time the rest of the enclosing block
+//   PROFILE_COUNT("name", n)	add n to a counter
+//   PROFILE_REPORT(prefix, name)	write all timers and counters as JSON to prefix + name and reset them
+// Totals are shared by all simulators in the process.
+
+#ifdef INSTRUMENT
+
+#include <string>
+#include <chrono>
+
+using namespace std;
+
+enum ProfileKind
+{
+	PROFILE_TIMER,
+	PROFILE_COUNTER
+};
+
+int profile_register(const char * name, const ProfileKind kind);
+void profile_add(const int slot, const long long amount);
+void profile_add_time(const int slot, const long long nanoseconds);
+void profile_report(const string & prefix, const char * name);
+
+class profile_timer
+	{
+	public:
+		profile_timer(const int slot) : slot(slot), start(chrono::steady_clock::now()) {}
+		~profile_timer()
+		{
+			profile_add_time(slot, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+		}
+		
+	private:
+		int slot;
+		chrono::steady_clock::time_point start;
+	};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) \
+	static const int PROFILE_CONCAT(profile_slot_, __LINE__) = profile_register(name, PROFILE_TIMER); \
+	profile_timer PROFILE_CONCAT(profile_timer_, __LINE__)(PROFILE_CONCAT(profile_slot_, __LINE__))
+#define PROFILE_COUNT(name, n) \
+	do { static const int profile_slot = profile_register(name, PROFILE_COUNTER); profile_add(profile_slot, n); } while(0)
+#define PROFILE_REPORT(prefix, name) profile_report(prefix, name)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(name, n) do {} while(0)
+#define PROFILE_REPORT(prefix, name) do {} while(0)
+
+#endif
+
+#endif
@@ -3,34 +3,174 @@
 
 #include "vessel.h"
 #include "simulator.h"
+#include "benchmark.h"
+#include "verify.h"
+#include "fleet_generator.h"
+#include "scenario_tree.h"
 
 using namespace std;
 
 int main(int argc, char** argv)
 {
-	ifstream datafile;
-	datafile.open("cv_sector_data.csv");
-	
-	/*
-	 if (argc > 1)
-	 datafile.open(argv[1]);
-	 else
-	 {
-	 cerr << "Usage: pollockDataProcessor datafile\n";
-	 return 1;
-	 }
-	 */
+	// pollockDataProcessor -benchmark [seconds per benchmark]
+	if(argc > 1 && string(argv[1]) == "-benchmark")
+		return run_benchmarks("cv_sector_data.csv", "benchmark.csv", argc > 2 ? atof(argv[2]) : 0.25);
+	
+	// pollockDataProcessor -verify [runs]: compare against golden/ and time the runs
+	if(argc > 1 && string(argv[1]) == "-verify")
+	{
+		verify_options options = default_verify_options();
+		if(argc > 2)
+			options.runs = atoi(argv[2]);
+		return run_verify(options);
+	}
+	
+	// pollockDataProcessor -generate scale seed file: a synthetic fleet scale times
+	// the size of cv_sector_data.csv, as CSV or (for .col files) a column file
+	if(argc > 4 && string(argv[1]) == "-generate")
+	{
+		ifstream datafile("cv_sector_data.csv");
+		simulator my_simulator;
+		my_simulator.read_in_landings(datafile);
+		datafile.close();
+		
+		fleet_generator generator;
+		if(!generator.fit(my_simulator.get_landings()))
+		{
+			cerr << "no landings to fit.\n";
+			return 1;
+		}
+		vector<landing> landings;
+		generator.generate(atoi(argv[2]), strtoull(argv[3], NULL, 10), landings);
+		
+		string filename = argv[4];
+		bool columns = filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".col") == 0;
+		bool saved = columns ? write_landings_columns(filename, landings) : write_landings_csv(filename, landings);
+		cerr << "generated " << landings.size() << " landings for " << atoi(argv[2]) * generator.num_profiles() << " vessels.\n";
+		return saved ? 0 : 1;
+	}
+	
+	// pollockDataProcessor -print-factor-log log file: a factor log as CSV
+	if(argc > 3 && string(argv[1]) == "-print-factor-log")
+	{
+		print_factor_log(argv[2], argv[3]);
+		return 0;
+	}
+	
+	// pollockDataProcessor [-db results file] [-factor-log log file] [-sweep sweep file]
+	//                      [-penalty curve] [-sinks list] [-fleet-series] [-from year] [landings file]:
+	// cv_sector_data.csv unless given, and .col files written by -generate are
+	// read as columns; -db also adds the run to a results database (needs a
+	// HAVE_SQLITE build), -factor-log appends the credit factors to a log,
+	// -sweep runs the scenarios of a sweep file (see scenario_tree::load) as a
+	// scenario tree instead of the single run, -penalty selects a built-in
+	// penalty curve or one defined in penalty_curves.txt, and -sinks chooses
+	// the output from csv, columnar, summary, store and none (csv,store unless
+	// given; see parse_sinks); -fleet-series also writes the fleet totals at
+	// the end of each fishing day to fleet_series.<year>.csv, and -from starts
+	// at a later year from the credit factors an earlier run with the same
+	// parameters stored for the year before
+	string landings_file = "cv_sector_data.csv";
+	string database_file;
+	string factor_log_file;
+	string sweep_file;
+	string penalty_curve;
+	int sinks = CSV_SINK | STORE_SINK;
+	bool fleet_series = false;
+	int first_year = 2000;
+	for(int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if(arg == "-db" && i + 1 < argc)
+			database_file = argv[++i];
+		else if(arg == "-factor-log" && i + 1 < argc)
+			factor_log_file = argv[++i];
+		else if(arg == "-sweep" && i + 1 < argc)
+			sweep_file = argv[++i];
+		else if(arg == "-penalty" && i + 1 < argc)
+			penalty_curve = argv[++i];
+		else if(arg == "-fleet-series")
+			fleet_series = true;
+		else if(arg == "-from" && i + 1 < argc)
+			first_year = atoi(argv[++i]);
+		else if(arg == "-sinks" && i + 1 < argc)
+		{
+			sinks = parse_sinks(argv[++i]);
+			if(sinks < 0)
+			{
+				cerr << "unknown output sink in " << argv[i] << ".\n";
+				return 1;
+			}
+		}
+		else
+			landings_file = arg;
+	}
+	bool columns = landings_file.size() > 4 && landings_file.compare(landings_file.size() - 4, 4, ".col") == 0;
 	
 	simulator my_simulator;
 	
 	// read in raw landings data
-	vector<landing> raw_data;
-	vector<string> column_names;
-	my_simulator.read_in_landings(datafile);
-	datafile.close();
+	if(columns)
+	{
+		vector<landing> landings;
+		if(!read_landings_columns(landings_file, landings))
+			return 1;
+		my_simulator.set_landings(landings);
+	}
+	else
+	{
+		ifstream datafile;
+		datafile.open(landings_file.c_str());
+		my_simulator.read_in_landings(datafile);
+		datafile.close();
+	}
+	
+	// optional user-defined penalty curves
+	my_simulator.load_penalty_curves("penalty_curves.txt");
+	if(penalty_curve.length() > 0 && !my_simulator.set_penalty_curve(penalty_curve))
+		return 1;
+	
+	if(factor_log_file.length() > 0 && !my_simulator.set_factor_log(factor_log_file))
+	{
+		cerr << "could not open " << factor_log_file << ".\n";
+		return 1;
+	}
+	
+	results_db database;
+	if(database_file.length() > 0)
+	{
+		if(!database.open(database_file))
+			return 1;
+		sinks |= DATABASE_SINK;
+	}
+	my_simulator.set_output_sinks(sinks);
+	my_simulator.set_fleet_series(fleet_series);
+	
+	if(sweep_file.length() > 0)
+	{
+		scenario_tree tree(my_simulator, 2000);
+		int num_scenarios = tree.load(sweep_file);
+		if(num_scenarios <= 0)
+		{
+			if(num_scenarios == 0)
+				cerr << "no scenarios in " << sweep_file << ".\n";
+			return 1;
+		}
+		if(database.is_open())
+			tree.set_results_db(&database, landings_file);
+		tree.run();
+		cerr << tree.num_scenarios() << " scenarios (" << tree.num_scenario_years() << " years) in ";
+		cerr << tree.num_nodes() << " simulated years.\n";
+		database.close();
+		return 0;
+	}
+	
+	if(database.is_open())
+		my_simulator.set_results_db(&database, landings_file);
 	
 	// process data
-	my_simulator.process();
+	my_simulator.process(first_year);
+	database.close();
 	
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+/*
+ *  output_writer.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include "output_writer.h"
+
+output_writer::output_writer(const size_t max_pending)
+{
+	pending_bytes = 0;
+	this->max_pending = max_pending;
+	busy = false;
+	stopping = false;
+	worker = thread(&output_writer::run, this);
+}
+
+output_writer::~output_writer()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	work_ready.notify_one();
+	worker.join();
+}
+
+// queue a file to be written; the contents are moved, not copied
+void output_writer::write(const string & filename, string contents)
+{
+	unique_lock<mutex> guard(lock);
+	while(pending_bytes > max_pending)
+		work_done.wait(guard);
+	
+	output_file file;
+	file.filename = filename;
+	queue.push_back(file);
+	queue.back().contents.swap(contents);
+	pending_bytes += queue.back().contents.size();
+	guard.unlock();
+	work_ready.notify_one();
+	return;
+}
+
+// wait until everything queued so far is on disk
+void output_writer::flush()
+{
+	unique_lock<mutex> guard(lock);
+	while(!queue.empty() || busy)
+		work_done.wait(guard);
+	return;
+}
+
+void output_writer::run()
+{
+	output_file file;
+	unique_lock<mutex> guard(lock);
+	while(true)
+	{
+		while(queue.empty() && !stopping)
+			work_ready.wait(guard);
+		if(queue.empty())
+			break;
+		
+		file.filename.swap(queue.front().filename);
+		file.contents.swap(queue.front().contents);
+		queue.pop_front();
+		busy = true;
+		guard.unlock();
+		
+		ofstream out;
+		out.open(file.filename.c_str(), ios::out | ios::binary);
+		if(out.is_open())
+			out.write(file.contents.data(), file.contents.size());
+		if(!out.is_open() || !out)
+			cerr << "could not write " << file.filename << ".\n";
+		out.close();
+		
+		guard.lock();
+		pending_bytes -= file.contents.size();
+		busy = false;
+		work_done.notify_all();
+	}
+	return;
+}
@@ -0,0 +1,48 @@
+/*
+ *  output_writer.h
+ *  processor
+ *
+ */
+
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// writes whole files on a background thread, so the simulation can go on to
+// the next year while the last one's output is still going to disk
+class output_writer
+	{
+	public:
+		output_writer(const size_t max_pending = 64 << 20);
+		~output_writer();
+		
+		void write(const string & filename, string contents);
+		void flush();
+		
+	private:
+		struct output_file
+		{
+			string filename;
+			string contents;
+		};
+		
+		void run();
+		
+		deque<output_file> queue;
+		size_t pending_bytes;	// queued and not yet written
+		size_t max_pending;		// write() waits while more than this is pending
+		bool busy;
+		bool stopping;
+		mutex lock;
+		condition_variable work_ready, work_done;
+		thread worker;
+	};
+
+#endif
@@ -0,0 +1,270 @@
+/*
+ *  penalty_curves.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+#include "penalty_curves.h"
+
+// table resolution, in entries per unit of z
+const double CURVE_STEPS = 1024;
+
+penalty_curve::penalty_curve()
+{
+	table.values = NULL;
+	table.size = 0;
+	table.z_min = 0;
+	table.steps = CURVE_STEPS;
+	table.below = 0;
+	table.above = 0;
+}
+
+penalty_curve::penalty_curve(const penalty_curve & other)
+{
+	*this = other;
+}
+
+penalty_curve & penalty_curve::operator =(const penalty_curve & other)
+{
+	name = other.name;
+	values = other.values;
+	table = other.table;
+	table.values = values.empty() ? NULL : &values[0];
+	return *this;
+}
+
+penalty_curve::~penalty_curve()
+{
+}
+
+// sample a curve given as a function on [z_min, z_max]; the first entry is
+// taken just inside z_min so a jump at the lower edge is not smeared out
+void penalty_curve::compile(const string & name, double (*function)(const double), 
+							const double z_min, const double z_max, const double below, const double above)
+{
+	int size = int((z_max - z_min) * CURVE_STEPS + 0.5) + 1;
+	
+	this->name = name;
+	values.resize(size);
+	values[0] = function(nextafter(z_min, z_max));
+	for(int i = 1; i < size; i++)
+		values[i] = function(z_min + i / CURVE_STEPS);
+	
+	table.values = &values[0];
+	table.size = size;
+	table.z_min = z_min;
+	table.steps = CURVE_STEPS;
+	table.below = below;
+	table.above = above;
+	return;
+}
+
+// compile from control points, joined by straight lines or by a monotone cubic
+// (Fritsch-Carlson) that does not overshoot the points; the curve is flat
+// outside the first and last points
+bool penalty_curve::compile(const string & name, const vector<double> & z_points, 
+							const vector<double> & p_points, const bool spline)
+{
+	int num_points = z_points.size();
+	if(num_points < 2 || p_points.size() != num_points)
+		return false;
+	for(int k = 1; k < num_points; k++)
+	{
+		if(z_points[k] <= z_points[k-1])
+			return false;
+	}
+	
+	// secant slopes, and tangents at each point for the spline
+	vector<double> secant(num_points - 1), tangent(num_points, 0);
+	for(int k = 0; k < num_points - 1; k++)
+		secant[k] = (p_points[k+1] - p_points[k]) / (z_points[k+1] - z_points[k]);
+	if(spline)
+	{
+		tangent[0] = secant[0];
+		tangent[num_points-1] = secant[num_points-2];
+		for(int k = 1; k < num_points - 1; k++)
+		{
+			if(secant[k-1] * secant[k] > 0)
+				tangent[k] = (secant[k-1] + secant[k]) / 2;
+		}
+		double a, b, r;
+		for(int k = 0; k < num_points - 1; k++)
+		{
+			if(secant[k] == 0)
+			{
+				tangent[k] = 0;
+				tangent[k+1] = 0;
+				continue;
+			}
+			a = tangent[k] / secant[k];
+			b = tangent[k+1] / secant[k];
+			r = a * a + b * b;
+			if(r > 9)
+			{
+				tangent[k] = 3 * a / sqrt(r) * secant[k];
+				tangent[k+1] = 3 * b / sqrt(r) * secant[k];
+			}
+		}
+	}
+	
+	double z_min = z_points[0];
+	int size = int((z_points[num_points-1] - z_min) * CURVE_STEPS + 0.5) + 1;
+	double z, h, t;
+	int k = 0;
+	
+	this->name = name;
+	values.resize(size);
+	for(int i = 0; i < size; i++)
+	{
+		z = z_min + i / CURVE_STEPS;
+		while(k < num_points - 2 && z > z_points[k+1])
+			k++;
+		h = z_points[k+1] - z_points[k];
+		t = (z - z_points[k]) / h;
+		if(t > 1)
+			t = 1;
+		if(spline) // cubic Hermite basis
+		{
+			values[i] = (2*t*t*t - 3*t*t + 1) * p_points[k] + 
+			(t*t*t - 2*t*t + t) * h * tangent[k] + 
+			(-2*t*t*t + 3*t*t) * p_points[k+1] + 
+			(t*t*t - t*t) * h * tangent[k+1];
+		}
+		else
+		{
+			values[i] = p_points[k] + t * (p_points[k+1] - p_points[k]);
+		}
+	}
+	
+	table.values = &values[0];
+	table.size = size;
+	table.z_min = z_min;
+	table.steps = CURVE_STEPS;
+	table.below = p_points[0];
+	table.above = p_points[num_points-1];
+	return true;
+}
+
+double penalty_curve::evaluate(const double z_score) const
+{
+	return table_lookup(table, z_score);
+}
+
+void penalty_curve::evaluate(const double * z_scores, double * p_values, const int n) const
+{
+	table_lookup_batch(table, z_scores, p_values, n);
+	return;
+}
+
+penalty_registry::penalty_registry()
+{
+	// built-in curves, in PenaltyType order
+	penalty_curve curve;
+	curve.compile("normal", normal_pvalue, -3, 3, 0, 1);
+	add(curve);
+	curve.compile("shallow", shallow_slope, -3, 3, 0, 1);
+	add(curve);
+	curve.compile("moderate", moderate_slope, -3, 3, 0, 1);
+	add(curve);
+	curve.compile("linear", linear, -3, 3, 0, 1);
+	add(curve);
+}
+
+penalty_registry::~penalty_registry()
+{
+}
+
+// each line of the file is
+//   name linear|spline z1,p1 z2,p2 ...
+// with the control points in increasing z; blank lines and lines starting
+// with # are skipped, and a name that is already defined is replaced
+bool penalty_registry::load(const string & filename)
+{
+	ifstream in;
+	in.open(filename.c_str());
+	if(!in.is_open())
+		return false;
+	
+	string line_buffer, name, kind, point;
+	vector<double> z_points, p_points;
+	double z, p;
+	int used;
+	bool bad_point;
+	int line_number = 0;
+	bool ok = true;
+	penalty_curve curve;
+	
+	while(getline(in, line_buffer))
+	{
+		line_number++;
+		istringstream line(line_buffer);
+		if(!(line >> name) || name[0] == '#')
+			continue;
+		
+		line >> kind;
+		z_points.clear();
+		p_points.clear();
+		bad_point = false;
+		while(line >> point)
+		{
+			// the whole token must be one z,p pair
+			used = 0;
+			if(sscanf(point.c_str(), "%lf,%lf%n", &z, &p, &used) != 2 || used != point.length())
+			{
+				cerr << filename << ":" << line_number << ": bad control point " << point << ".\n";
+				bad_point = true;
+				break;
+			}
+			z_points.push_back(z);
+			p_points.push_back(p);
+		}
+		
+		if(bad_point || (kind != "linear" && kind != "spline") || 
+		   !curve.compile(name, z_points, p_points, kind == "spline"))
+		{
+			cerr << filename << ":" << line_number << ": bad penalty curve " << name << ".\n";
+			ok = false;
+			continue;
+		}
+		add(curve);
+	}
+	in.close();
+	return ok;
+}
+
+int penalty_registry::add(const penalty_curve & curve)
+{
+	int index = find(curve.name);
+	if(index >= 0)
+	{
+		curves[index] = curve;
+		return index;
+	}
+	curves.push_back(curve);
+	return curves.size() - 1;
+}
+
+int penalty_registry::find(const string & name) const
+{
+	for(int i = 0; i < curves.size(); i++)
+	{
+		if(curves[i].name == name)
+			return i;
+	}
+	return -1;
+}
+
+int penalty_registry::size() const
+{
+	return curves.size();
+}
+
+const penalty_curve & penalty_registry::operator [](const int index) const
+{
+	return curves[index];
+}
@@ -0,0 +1,58 @@
+/*
+ *  penalty_curves.h
+ *  processor
+ *
+ */
+
+#ifndef PENALTY_CURVES_H
+#define PENALTY_CURVES_H
+
+#include <string>
+#include <vector>
+#include "simulator_tools.h"
+
+using namespace std;
+
+// a penalty curve p(z) compiled into a dense lookup table, so every curve
+// costs the same to evaluate whatever its shape
+class penalty_curve
+	{
+	public:
+		penalty_curve();
+		penalty_curve(const penalty_curve & other);
+		penalty_curve & operator =(const penalty_curve & other);
+		~penalty_curve();
+		
+		void compile(const string & name, double (*function)(const double), 
+					 const double z_min, const double z_max, const double below, const double above);
+		bool compile(const string & name, const vector<double> & z_points, 
+					 const vector<double> & p_points, const bool spline);
+		double evaluate(const double z_score) const;
+		void evaluate(const double * z_scores, double * p_values, const int n) const;
+		
+		string name;
+		
+	private:
+		vector<double> values;
+		lookup_table table;
+	};
+
+// named penalty curves; the built-in curves take the PenaltyType values as
+// their indices and curves loaded from a file follow them
+class penalty_registry
+	{
+	public:
+		penalty_registry();
+		~penalty_registry();
+		
+		bool load(const string & filename);
+		int add(const penalty_curve & curve);
+		int find(const string & name) const;
+		int size() const;
+		const penalty_curve & operator [](const int index) const;
+		
+	private:
+		vector<penalty_curve> curves;
+	};
+
+#endif
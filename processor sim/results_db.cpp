@@ -0,0 +1,271 @@
+/*
+ *  results_db.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include "results_db.h"
+
+#ifdef HAVE_SQLITE
+#include <sqlite3.h>
+#endif
+
+// rows queued before add_row() waits for the writer
+const size_t MAX_QUEUED_ROWS = 1 << 18;
+
+// how long a write waits for another process's transaction
+const int BUSY_TIMEOUT_MS = 10000;
+
+// values per row of each table, after scenario and year (and name, coop)
+const int NUM_TABLE_VALUES[NUM_RESULTS_TABLES] = {0, 13, 6, 16};
+
+#ifdef HAVE_SQLITE
+static const char * SCHEMA = 
+"CREATE TABLE IF NOT EXISTS scenarios (id INTEGER PRIMARY KEY, label TEXT);"
+"CREATE TABLE IF NOT EXISTS parameters (scenario INTEGER, year INTEGER, "
+"hard_cap REAL, target_cap REAL, alpha REAL, beta REAL, gamma REAL, "
+"penalty_func INTEGER, trading_rule INTEGER, delta REAL, epsilon REAL, "
+"purchase_limit REAL, stranding_limit REAL, tax_rate REAL, psi REAL, "
+"PRIMARY KEY (scenario, year));"
+"CREATE TABLE IF NOT EXISTS summaries (scenario INTEGER, year INTEGER, "
+"target_level REAL, credits_distributed REAL, credits_used REAL, "
+"credits_transferred REAL, credits_held REAL, original_bycatch INTEGER, "
+"PRIMARY KEY (scenario, year));"
+"CREATE TABLE IF NOT EXISTS vessels (scenario INTEGER, year INTEGER, name TEXT, coop TEXT, "
+"pollock_A REAL, chinook_A INTEGER, uncaught_pollock_A REAL, bycatch_rate_A REAL, "
+"credit_factor_A REAL, credits_A INTEGER, z_A REAL, q_A REAL, "
+"pollock_B REAL, chinook_B INTEGER, uncaught_pollock_B REAL, bycatch_rate_B REAL, "
+"credit_factor_B REAL, credits_B INTEGER, z_B REAL, q_B REAL);"
+"CREATE INDEX IF NOT EXISTS vessels_by_scenario ON vessels (scenario, year);";
+
+static const char * INSERTS[NUM_RESULTS_TABLES] = {
+	"INSERT INTO scenarios (label) VALUES (?)", 
+	"INSERT OR REPLACE INTO parameters VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", 
+	"INSERT OR REPLACE INTO summaries VALUES (?, ?, ?, ?, ?, ?, ?, ?)", 
+	"INSERT INTO vessels VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"};
+#endif
+
+results_db::results_db()
+{
+	db = NULL;
+	for(int t = 0; t < NUM_RESULTS_TABLES; t++)
+		statements[t] = NULL;
+	busy = false;
+	stopping = false;
+}
+
+results_db::~results_db()
+{
+	close();
+}
+
+bool results_db::open(const string & filename)
+{
+	close();
+#ifdef HAVE_SQLITE
+	sqlite3 * handle;
+	if(sqlite3_open(filename.c_str(), &handle) != SQLITE_OK)
+	{
+		cerr << "could not open " << filename << ": " << sqlite3_errmsg(handle) << ".\n";
+		sqlite3_close(handle);
+		return false;
+	}
+	db = handle;
+	
+	sqlite3_busy_timeout(handle, BUSY_TIMEOUT_MS);
+	sqlite3_exec(handle, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+	char * message = NULL;
+	bool ok = sqlite3_exec(handle, SCHEMA, NULL, NULL, &message) == SQLITE_OK;
+	for(int t = 0; ok && t < NUM_RESULTS_TABLES; t++)
+	{
+		sqlite3_stmt * statement;
+		ok = sqlite3_prepare_v2(handle, INSERTS[t], -1, &statement, NULL) == SQLITE_OK;
+		statements[t] = statement;
+	}
+	if(!ok)
+	{
+		cerr << filename << ": " << (message != NULL ? message : sqlite3_errmsg(handle)) << ".\n";
+		sqlite3_free(message);
+		close();
+		return false;
+	}
+	
+	stopping = false;
+	worker = thread(&results_db::run, this);
+	return true;
+#else
+	cerr << "cannot open " << filename << ": built without SQLite (define HAVE_SQLITE).\n";
+	return false;
+#endif
+}
+
+void results_db::close()
+{
+	if(worker.joinable())
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			stopping = true;
+		}
+		work_ready.notify_one();
+		worker.join();
+	}
+#ifdef HAVE_SQLITE
+	for(int t = 0; t < NUM_RESULTS_TABLES; t++)
+	{
+		sqlite3_finalize((sqlite3_stmt *)statements[t]);
+		statements[t] = NULL;
+	}
+	sqlite3_close((sqlite3 *)db);
+#endif
+	db = NULL;
+	return;
+}
+
+bool results_db::is_open() const
+{
+	return db != NULL;
+}
+
+// register a run; its row is written at once, outside the writer's batches,
+// and SQLite picks the id, so runs in other processes never get the same one;
+// 0 when the database is not open or the row could not be written
+int results_db::add_scenario(const string & label)
+{
+	if(!is_open())
+		return 0;
+	int scenario = 0;
+#ifdef HAVE_SQLITE
+	lock_guard<mutex> guard(connection);
+	sqlite3 * handle = (sqlite3 *)db;
+	sqlite3_stmt * statement = (sqlite3_stmt *)statements[SCENARIOS_TABLE];
+	sqlite3_bind_text(statement, 1, label.c_str(), -1, SQLITE_TRANSIENT);
+	if(sqlite3_step(statement) == SQLITE_DONE)
+		scenario = int(sqlite3_last_insert_rowid(handle));
+	else
+		cerr << "results database: " << sqlite3_errmsg(handle) << ".\n";
+	sqlite3_reset(statement);
+#else
+	(void)label;
+#endif
+	return scenario;
+}
+
+void results_db::add_row(const results_row & row)
+{
+	if(!is_open())
+		return;
+	unique_lock<mutex> guard(lock);
+	while(queue.size() >= MAX_QUEUED_ROWS)
+		work_done.wait(guard);
+	queue.push_back(row);
+	guard.unlock();
+	work_ready.notify_one();
+	return;
+}
+
+// wait until every row added so far is committed
+void results_db::flush()
+{
+	unique_lock<mutex> guard(lock);
+	while(!queue.empty() || busy)
+		work_done.wait(guard);
+	return;
+}
+
+// rows of a table written for a scenario, after waiting for the writer; -1
+// when the database is not open
+long long results_db::count_rows(const int table, const int scenario)
+{
+	if(!is_open())
+		return -1;
+	flush();
+	long long count = -1;
+#ifdef HAVE_SQLITE
+	static const char * COUNTS[NUM_RESULTS_TABLES] = {
+		"SELECT COUNT(*) FROM scenarios WHERE id = ?", 
+		"SELECT COUNT(*) FROM parameters WHERE scenario = ?", 
+		"SELECT COUNT(*) FROM summaries WHERE scenario = ?", 
+		"SELECT COUNT(*) FROM vessels WHERE scenario = ?"};
+	sqlite3_stmt * query;
+	if(sqlite3_prepare_v2((sqlite3 *)db, COUNTS[table], -1, &query, NULL) == SQLITE_OK)
+	{
+		sqlite3_bind_int(query, 1, scenario);
+		if(sqlite3_step(query) == SQLITE_ROW)
+			count = sqlite3_column_int64(query, 0);
+		sqlite3_finalize(query);
+	}
+#else
+	(void)table;
+	(void)scenario;
+#endif
+	return count;
+}
+
+void results_db::run()
+{
+	vector<results_row> rows;
+	unique_lock<mutex> guard(lock);
+	while(true)
+	{
+		while(queue.empty() && !stopping)
+			work_ready.wait(guard);
+		if(queue.empty())
+			break;
+		
+		// take everything queued as one batch
+		rows.swap(queue);
+		busy = true;
+		guard.unlock();
+		work_done.notify_all();
+		
+		write_rows(rows);
+		rows.clear();
+		
+		guard.lock();
+		busy = false;
+		work_done.notify_all();
+	}
+	return;
+}
+
+// one transaction per batch
+void results_db::write_rows(vector<results_row> & rows)
+{
+#ifdef HAVE_SQLITE
+	lock_guard<mutex> guard(connection);
+	sqlite3 * handle = (sqlite3 *)db;
+	sqlite3_exec(handle, "BEGIN IMMEDIATE", NULL, NULL, NULL);
+	for(int i = 0; i < rows.size(); i++)
+	{
+		const results_row & row = rows[i];
+		sqlite3_stmt * statement = (sqlite3_stmt *)statements[row.table];
+		int column = 1;
+		
+		sqlite3_bind_int(statement, column++, row.scenario);
+		sqlite3_bind_int(statement, column++, row.year);
+		if(row.table == VESSELS_TABLE)
+		{
+			sqlite3_bind_text(statement, column++, row.name.c_str(), -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(statement, column++, row.coop.c_str(), -1, SQLITE_TRANSIENT);
+		}
+		// NaN marks a value that does not apply
+		for(int k = 0; k < NUM_TABLE_VALUES[row.table]; k++, column++)
+		{
+			if(row.values[k] != row.values[k])
+				sqlite3_bind_null(statement, column);
+			else
+				sqlite3_bind_double(statement, column, row.values[k]);
+		}
+		
+		if(sqlite3_step(statement) != SQLITE_DONE)
+			cerr << "results database: " << sqlite3_errmsg(handle) << ".\n";
+		sqlite3_reset(statement);
+	}
+	sqlite3_exec(handle, "COMMIT", NULL, NULL, NULL);
+#else
+	(void)rows;
+#endif
+	return;
+}
@@ -0,0 +1,76 @@
+/*
+ *  results_db.h
+ *  processor
+ *
+ */
+
+#ifndef RESULTS_DB_H
+#define RESULTS_DB_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// tables of the results database, one row kind each
+enum ResultsTable
+{
+	SCENARIOS_TABLE,	// id, label
+	PARAMETERS_TABLE,	// scenario, year, policy parameters
+	SUMMARIES_TABLE,	// scenario, year, summary_output columns
+	VESSELS_TABLE,		// scenario, year, name, coop, season values
+	NUM_RESULTS_TABLES
+};
+
+const int MAX_RESULT_VALUES = 16;
+
+struct results_row
+{
+	int table;
+	int scenario;
+	int year;
+	string name, coop;		// of a vessel row
+	double values[MAX_RESULT_VALUES];
+};
+
+// SQLite file collecting the results of many runs. Any number of simulators
+// may add rows; they are queued and written in batched transactions by one
+// writer thread, with the database in WAL mode so it can be queried while a
+// campaign is running. Scenario ids come from SQLite as each scenario is
+// added, so several processes can write to one file. Without HAVE_SQLITE,
+// open() always fails.
+class results_db
+	{
+	public:
+		results_db();
+		~results_db();
+		
+		bool open(const string & filename);
+		void close();
+		bool is_open() const;
+		
+		int add_scenario(const string & label);
+		void add_row(const results_row & row);
+		void flush();
+		long long count_rows(const int table, const int scenario);
+		
+	private:
+		void run();
+		void write_rows(vector<results_row> & rows);
+		
+		void * db;				// sqlite3 *
+		void * statements[NUM_RESULTS_TABLES];	// sqlite3_stmt *
+		mutex connection;		// one transaction at a time on db
+		
+		vector<results_row> queue;
+		bool busy;
+		bool stopping;
+		mutex lock;
+		condition_variable work_ready, work_done;
+		thread worker;
+	};
+
+#endif
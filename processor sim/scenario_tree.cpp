@@ -0,0 +1,322 @@
+/*
+ *  scenario_tree.cpp
+ *  processor
+ *
+ */
+
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include "scenario_tree.h"
+
+scenario_tree::scenario_tree(simulator & sim, const int first_year) : sim(sim)
+{
+	this->first_year = first_year;
+	database = NULL;
+	
+	scenario_node root;
+	root.year = first_year - 1;
+	root.params = sim.get_params();
+	nodes.push_back(root);
+}
+
+scenario_tree::~scenario_tree()
+{
+}
+
+int scenario_tree::add_scenario(const vector<policy_params> & params_by_year)
+{
+	int scenario = scenario_paths.size();
+	int num_years = params_by_year.size();
+	int node = 0;
+	int child;
+	vector<int> path;
+	char prefix[40];
+	
+	// walk down the shared prefix, branching where the parameters first differ
+	for(int i = 0; i < num_years; i++)
+	{
+		child = -1;
+		for(int j = 0; j < nodes[node].children.size(); j++)
+		{
+			if(nodes[nodes[node].children[j]].params == params_by_year[i])
+			{
+				child = nodes[node].children[j];
+				break;
+			}
+		}
+		if(child < 0)
+		{
+			scenario_node new_node;
+			new_node.year = first_year + i;
+			new_node.params = params_by_year[i];
+			sprintf(prefix, "node_%d.", int(nodes.size()));
+			new_node.prefix = prefix;
+			
+			child = nodes.size();
+			nodes.push_back(new_node);
+			nodes[node].children.push_back(child);
+		}
+		node = child;
+		path.push_back(node);
+		nodes[node].branch_scenarios.push_back(scenario);
+	}
+	nodes[node].scenarios.push_back(scenario);
+	scenario_paths.push_back(path);
+	
+	return scenario;
+}
+
+// sets one NAME=value setting, named as in policy_params; false for an
+// unknown name or a bad value
+static bool parse_setting(const simulator & sim, const string & setting, policy_params & params)
+{
+	int equals = setting.find('=');
+	if(equals == string::npos)
+		return false;
+	string name = setting.substr(0, equals);
+	string value = setting.substr(equals + 1);
+	
+	if(name == "PENALTY")
+	{
+		params.penalty_func = sim.find_penalty_curve(value);
+		return params.penalty_func >= 0;
+	}
+	if(name == "TRADING_RULE")
+	{
+		if(value == "DYNAMIC_SALMON_SAVINGS")
+			params.trading_rule = DYNAMIC_SALMON_SAVINGS;
+		else if(value == "FIXED_TRANSFER_TAX")
+			params.trading_rule = FIXED_TRANSFER_TAX;
+		else
+			return false;
+		return true;
+	}
+	
+	double * field = NULL;
+	if(name == "HARD_CAP")
+		field = &params.HARD_CAP;
+	else if(name == "TARGET_CAP")
+		field = &params.TARGET_CAP;
+	else if(name == "ALPHA")
+		field = &params.ALPHA;
+	else if(name == "BETA")
+		field = &params.BETA;
+	else if(name == "GAMMA")
+		field = &params.GAMMA;
+	else if(name == "DELTA")
+		field = &params.DELTA;
+	else if(name == "EPSILON")
+		field = &params.EPSILON;
+	else if(name == "PURCHASE_LIMIT")
+		field = &params.PURCHASE_LIMIT;
+	else if(name == "DYNAMIC_STRANDING_LIMIT")
+		field = &params.DYNAMIC_STRANDING_LIMIT;
+	else if(name == "TAX_RATE")
+		field = &params.TAX_RATE;
+	else if(name == "PSI")
+		field = &params.PSI;
+	
+	char * end;
+	if(field == NULL || value.empty())
+		return false;
+	*field = strtod(value.c_str(), &end);
+	return *end == 0;
+}
+
+// each line of the file is one scenario, a list of years and the settings
+// that apply from that year to the end of the sweep, e.g.
+//   2004 TARGET_CAP=40000 2006 TRADING_RULE=FIXED_TRANSFER_TAX PENALTY=normal
+// other years keep the simulator's parameters, so a line that is only a year
+// is the unchanged run; blank lines and lines starting with # are skipped.
+// Returns the number of scenarios added, or -1 if any line is bad
+int scenario_tree::load(const string & filename)
+{
+	ifstream in;
+	in.open(filename.c_str());
+	if(!in.is_open())
+	{
+		cerr << "could not open " << filename << ".\n";
+		return -1;
+	}
+	
+	int num_years = LAST_SWEEP_YEAR - first_year + 1;
+	string line_buffer, token;
+	vector<policy_params> params_by_year;
+	int line_number = 0;
+	int year;
+	int added = 0;
+	bool bad;
+	bool ok = true;
+	char * end;
+	
+	while(getline(in, line_buffer))
+	{
+		line_number++;
+		istringstream line(line_buffer);
+		if(!(line >> token) || token[0] == '#')
+			continue;
+		
+		params_by_year.assign(num_years, nodes[0].params);
+		year = first_year;
+		bad = false;
+		do
+		{
+			int value = strtol(token.c_str(), &end, 10);
+			if(*end == 0)
+			{
+				year = value;
+				bad = (year < first_year || year > LAST_SWEEP_YEAR);
+				continue;
+			}
+			for(int i = year - first_year; !bad && i < num_years; i++)
+				bad = !parse_setting(sim, token, params_by_year[i]);
+		}
+		while(!bad && line >> token);
+		
+		if(bad)
+		{
+			cerr << filename << ":" << line_number << ": bad sweep setting " << token << ".\n";
+			ok = false;
+			continue;
+		}
+		add_scenario(params_by_year);
+		added++;
+	}
+	in.close();
+	return ok ? added : -1;
+}
+
+// DATABASE_SINK rows go to database, under a scenario of its own for each
+// leaf path labelled label followed by the scenario number; without a
+// database the sweep writes no rows
+void scenario_tree::set_results_db(results_db * database, const string & label)
+{
+	this->database = database;
+	this->label = label;
+	return;
+}
+
+void scenario_tree::run()
+{
+	credit_factor_ptr empty(new credit_factor_db);
+	char suffix[40];
+	
+	base_prefix = sim.get_output_prefix();
+	results_scenarios.clear();
+	for(int i = 0; database != NULL && i < scenario_paths.size(); i++)
+	{
+		sprintf(suffix, " scenario %d", i);
+		results_scenarios.push_back(database->add_scenario(label + suffix));
+	}
+	
+	sim.rewind_run_data(0);
+	for(int i = 0; i < nodes[0].children.size(); i++)
+	{
+		run_node(nodes[0].children[i], 0, empty);
+	}
+	print_scenario_index();
+	sim.flush_output();
+	
+	sim.set_params(nodes[0].params);
+	sim.set_output_prefix(base_prefix);
+	sim.set_results_scenarios(NULL, vector<int>());
+	return;
+}
+
+void scenario_tree::run_node(const int node, const int depth, const credit_factor_ptr & credit_factors)
+{
+	// the year's rows belong to every scenario that shares it
+	vector<int> ids;
+	for(int i = 0; database != NULL && i < nodes[node].branch_scenarios.size(); i++)
+		ids.push_back(results_scenarios[nodes[node].branch_scenarios[i]]);
+	sim.set_results_scenarios(database, ids);
+	
+	// children share this state until they first update it
+	sim.set_credit_factors(credit_factors);
+	sim.rewind_run_data(depth);
+	sim.set_params(nodes[node].params);
+	sim.set_output_prefix(base_prefix + nodes[node].prefix);
+	sim.process_year(nodes[node].year);
+	
+	credit_factor_ptr state = sim.get_credit_factors();
+	
+	for(int i = 0; i < nodes[node].scenarios.size(); i++)
+	{
+		sim.set_output_prefix(scenario_prefix(nodes[node].scenarios[i]));
+		sim.print_run_data();
+	}
+	
+	for(int i = 0; i < nodes[node].children.size(); i++)
+	{
+		run_node(nodes[node].children[i], depth + 1, state);
+	}
+	return;
+}
+
+void scenario_tree::print_scenario_index()
+{
+	csv_buffer out;
+	
+	// header row
+	out << "scenario,year,node,prefix\n";
+	
+	int num_scenarios = scenario_paths.size();
+	for(int i = 0; i < num_scenarios; i++)
+	{
+		for(int j = 0; j < scenario_paths[i].size(); j++)
+		{
+			int node = scenario_paths[i][j];
+			out << i << ",";
+			out << nodes[node].year << ",";
+			out << node << ",";
+			out << nodes[node].prefix << "\n";
+		}
+	}
+	if(!out.save(base_prefix + "scenario_tree.csv"))
+		cerr << "could not write " << base_prefix << "scenario_tree.csv.\n";
+	return;
+}
+
+int scenario_tree::num_nodes() const
+{
+	return nodes.size() - 1;
+}
+
+int scenario_tree::num_scenarios() const
+{
+	return scenario_paths.size();
+}
+
+int scenario_tree::num_scenario_years() const
+{
+	int total = 0;
+	for(int i = 0; i < scenario_paths.size(); i++)
+		total += scenario_paths[i].size();
+	return total;
+}
+
+const policy_params & scenario_tree::year_params(const int scenario, const int year) const
+{
+	return nodes[scenario_paths[scenario][year - first_year]].params;
+}
+
+// where run() wrote the scenario's files for a year
+string scenario_tree::year_prefix(const int scenario, const int year) const
+{
+	return base_prefix + nodes[scenario_paths[scenario][year - first_year]].prefix;
+}
+
+// where run() wrote the scenario's per-run files
+string scenario_tree::scenario_prefix(const int scenario) const
+{
+	char prefix[40];
+	sprintf(prefix, "scenario_%d.", scenario);
+	return base_prefix + prefix;
+}
+
+// the database id run() gave the scenario
+int scenario_tree::results_scenario(const int scenario) const
+{
+	return results_scenarios[scenario];
+}
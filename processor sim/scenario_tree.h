@@ -0,0 +1,67 @@
+/*
+ *  scenario_tree.h
+ *  processor
+ *
+ */
+
+#ifndef SCENARIO_TREE_H
+#define SCENARIO_TREE_H
+
+#include <string>
+#include <vector>
+#include "simulator.h"
+
+using namespace std;
+
+// the years a sweep replays, as in simulator::process()
+const int LAST_SWEEP_YEAR = 2007;
+
+// one simulated year; the path from the root to a node is a shared parameter prefix
+struct scenario_node
+{
+	int year;
+	policy_params params;
+	vector<int> children;
+	vector<int> scenarios;	// scenarios whose last year is this node
+	vector<int> branch_scenarios;	// scenarios whose path goes through this node
+	string prefix;			// output file prefix for this year
+};
+
+// a parameter sweep run as a tree of years; each output file name is prefixed
+// by the simulator's output prefix at the time of run(), then node_<n>. for
+// the per-year files and scenario_<k>. for the per-run files, and
+// scenario_tree.csv lists the node of every scenario year
+class scenario_tree
+	{
+	public:
+		
+		scenario_tree(simulator & sim, const int first_year);
+		~scenario_tree();
+		
+		int add_scenario(const vector<policy_params> & params_by_year);
+		int load(const string & filename);
+		void set_results_db(results_db * database, const string & label);
+		void run();
+		int num_nodes() const;
+		int num_scenarios() const;
+		int num_scenario_years() const;
+		const policy_params & year_params(const int scenario, const int year) const;
+		string year_prefix(const int scenario, const int year) const;
+		string scenario_prefix(const int scenario) const;
+		int results_scenario(const int scenario) const;
+		
+	private:
+		void run_node(const int node, const int depth, const credit_factor_ptr & credit_factors);
+		void print_scenario_index();
+		
+		simulator & sim;
+		int first_year;
+		vector<scenario_node> nodes;	// node 0 is the root and has no year
+		vector<vector<int> > scenario_paths;
+		string base_prefix;
+		results_db * database;
+		string label;
+		vector<int> results_scenarios;	// database id of each scenario
+	};
+
+#endif
@@ -9,6 +9,8 @@
 
 #include "simulator.h"
 
+const double LBS_PER_TONNE = 2204.6;
+
 bool operator <(const needy_struct & a, const needy_struct & b);
 
 simulator::simulator()
@@ -41,8 +43,20 @@ simulator::simulator()
 	// incentive modeling params
 	PSI = 0.25; // bycatch reduction factor
 	
-	// load table for normal distribution calculations
-	load_z_table();
+	// floor price params
+	FLOOR_PRICE_CHINOOK = 5000;
+	CREDIT_VALUE_A = 0.20;
+	CREDIT_VALUE_B = 0.12;
+	
+	resume_event = NUM_CHECKPOINTS;
+	for(int e = 0; e < NUM_CHECKPOINTS; e++)
+		checkpoints[e].valid = false;
+	
+	credit_factor_DB.reset(new credit_factor_db);
+	output_prefix = "";
+	record_fleet_series = false;
+	set_output_sinks(CSV_SINK | STORE_SINK);
+	database = NULL;
 }
 
 simulator::~simulator()
@@ -51,8 +65,12 @@ simulator::~simulator()
 
 void simulator::read_in_landings(istream & datafile)
 {
+	PROFILE_SCOPE("read_in_landings");
 	raw_data.clear();
+	year_sets.clear();
 	column_names.clear();
+	vessel_ids.clear();
+	vessel_keys.clear();
 	
 	string line_buffer;
 	string value_buffer;
@@ -123,53 +141,64 @@ void simulator::read_in_landings(istream & datafile)
 					break;
 			}
 		}
+		temp_landing.vessel_id = intern_vessel(temp_landing.name, temp_landing.coop);
 		raw_data.push_back(temp_landing);
 	}
 	
 	return;
 }
 
-void simulator::load_z_table()
+const vector<landing> & simulator::get_landings() const
 {
-	ifstream in;
-	in.open("z-table.txt");
-	
-	z_table.resize(601);
-	
-	for(int i = 0; i < 601; i++)
-	{
-		in >> z_table[i];
-	}
-	in.close();
+	return raw_data;
 }
 
-void simulator::process()
+// landings from somewhere other than a CSV file, e.g. the fleet generator
+void simulator::set_landings(const vector<landing> & landings)
 {
-	credit_factor_DB.clear();
+	raw_data = landings;
+	year_sets.clear();
+	for(int i = 0; i < raw_data.size(); i++)
+		raw_data[i].vessel_id = intern_vessel(raw_data[i].name, raw_data[i].coop);
+	return;
+}
+
+void simulator::process(int first_year)
+{
+	// start from fresh factors, clearing them in place unless a snapshot shares them
+	if(credit_factor_DB.use_count() == 1)
+		credit_factor_DB->clear();
+	else
+		credit_factor_DB.reset(new credit_factor_db);
+	credit_factor_DB->reserve(vessel_ids.size());
 	
-	unfished_pollock_A.clear();
-	unfished_pollock_B.clear();
+	rewind_run_data(0);
+	
+	// pick up where an earlier run with the same parameters left off
+	if(first_year > 2000 && !warm_start(first_year))
+	{
+		cerr << "no usable stored credit factors for " << first_year - 1 << ", starting from 2000.\n";
+		first_year = 2000;
+	}
 	
-	process_year(2000);
-	process_year(2001);
-	process_year(2002);
-	process_year(2003);
-	process_year(2004);
-	process_year(2005);
-	process_year(2006);
-	process_year(2007);
+	for(int year = first_year; year <= 2007; year++)
+	{
+		process_year(year);
+	}
 	
-	print_unfished_data();
+	print_run_data();
+	flush_output();
+	PROFILE_REPORT(output_prefix, "profile.json");
 	
 	return;
 }
 
 void simulator::process_year(const int year)
 {
+	PROFILE_SCOPE("process_year");
 	// filter out the desired season
-	vector<landing> year_data;
-	vector<vessel> vessel_data;
-	convert_data(raw_data, year, year_data, vessel_data);
+	vector<vessel> & vessel_data = year_vessels;
+	begin_year(load_year(year), vessel_data);
 	
 	// load credit allocation factors
 	load_credit_factors(vessel_data);
@@ -178,29 +207,38 @@ void simulator::process_year(const int year)
 	process_data(vessel_data, year);
 	
 	// simulate
-	simulate_year(vessel_data, year, year_data);
+	simulate_year(vessel_data, year);
 	
 	// update credit allocation factors
-	update_credit_factors(vessel_data);
+	update_credit_factors(vessel_data, year);
+	mutable_credit_factors().fingerprint = params_fingerprint(credit_factor_DB->fingerprint);
+	record_year(vessel_data, year);
 	
 	// print output
-	print_credit_data(vessel_data, year);
-	
-	// print vessel data
-	print_vessel_data(vessel_data, year);
+	if(output_sinks & CSV_SINK)
+	{
+		print_credit_data(vessel_data, year);
+		print_vessel_data(vessel_data, year);
+	}
+	if(output_sinks & COLUMNAR_SINK)
+		print_results(vessel_data, year);
+	if(output_sinks & DATABASE_SINK)
+		print_database(vessel_data, year);
+	print_fleet_series(year);
 	
 	// print credit deltas
 	// print_credit_deltas(vessel_data, year);
 	
 	// save data to db
-	save_vessel_data(vessel_data);
+	if(output_sinks & STORE_SINK)
+		save_vessel_data(year);
 	
 	return;
 }
 
-void simulator::convert_data(const vector<landing> & raw_data, const int year, 
-							 vector<landing> & year_data, vector<vessel> & vessel_data)
+void simulator::convert_data(const vector<landing> & raw_data, const int year, year_dataset & data)
 {
+	PROFILE_SCOPE("convert_data");
 	int num_data = raw_data.size();
 	int start_index = -1;
 	int end_index = -1;
@@ -216,106 +254,183 @@ void simulator::convert_data(const vector<landing> & raw_data, const int year,
 			break;
 	}
 	
+	vector<landing> & year_data = data.hauls;
+	vector<vessel_year> & vessel_years = data.vessels;
 	year_data.assign(raw_data.begin() + start_index, raw_data.begin() + end_index + 1);
 	
-	vessel_data.clear();
+	vessel_years.clear();
 	
 	num_data = year_data.size();
 	
-	start_date = day_count(year_data[0].year, year_data[0].month, year_data[0].day);
+	data.year = year;
+	data.start_date = day_count(year_data[0].year, year_data[0].month, year_data[0].day);
 	int end_date = day_count(year_data[num_data-1].year, year_data[num_data-1].month, year_data[num_data-1].day);
+	data.num_days = end_date - data.start_date + 1;
+	int start_b_season = day_count(year, 6, 11) - data.start_date;
 	
-	vessel new_vessel;
-	bool added;
-	
-	int day;
-	num_days = end_date - start_date + 1;
+	// vessel ids stand for the name and coop together
+	unordered_map<int, int> vessel_of_id;
+	unordered_map<string, int> vessel_of_name;
+	vessel_year new_vessel;
+	int day, index;
 	
+	// each season's floor price is tracked haul by haul until it is reached
+	vector<double> season_pollock;	// of each vessel so far this season
+	vector<int> season_chinook;
+	running_max worst_rate;
+	double sector_pollock = 0;
+	int sector_chinook = 0;
+	floor_price * floor = &data.floor_A;
+	data.floor_A.date = -1;
+	data.floor_B.date = -1;
+	
+	data.haul_day.resize(num_data);
+	data.haul_vessel.resize(num_data);
 	for(int i = 0; i < num_data; i++)
 	{
-		added = false;
-		for(int j = 0; j < vessel_data.size(); j++)
+		day = day_count(year_data[i].year, year_data[i].month, year_data[i].day) - data.start_date;
+		data.haul_day[i] = day;
+		
+		unordered_map<int, int>::iterator found = vessel_of_id.find(year_data[i].vessel_id);
+		if(found != vessel_of_id.end())
 		{
-			if ((vessel_data[j].name.compare(year_data[i].name) == 0) && 
-				(vessel_data[j].coop.compare(year_data[i].coop) == 0))
-			{
-				day = day_count(year_data[i].year, year_data[i].month, year_data[i].day) - start_date;
-				
-				vessel_data[j].pollock[day] += year_data[i].pollock;
-				vessel_data[j].chinook[day] += int(year_data[i].chinook+0.5);
-				
-				added = true;
-				break;
-			}
+			index = found->second;
 		}
-		if(!added)
+		else
 		{
-			day = day_count(year_data[i].year, year_data[i].month, year_data[i].day) - start_date;
-			
 			new_vessel.set_name(year_data[i].name);
 			new_vessel.set_coop(year_data[i].coop);
-			new_vessel.set_num_days(num_days);
-			
-			new_vessel.pollock[day] += year_data[i].pollock;
-			new_vessel.chinook[day] += int(year_data[i].chinook+0.5);
-			
-			vessel_index[new_vessel.name] = vessel_data.size();
+			new_vessel.id = year_data[i].vessel_id;
 			
-			vessel_data.push_back(new_vessel);
+			index = vessel_years.size();
+			vessel_of_id[new_vessel.id] = index;
+			vessel_of_name[new_vessel.name] = index;
+			vessel_years.push_back(new_vessel);
+		}
+		vessel_years[index].daily.add(day, year_data[i].pollock, int(year_data[i].chinook+0.5));
+		
+		if(day >= start_b_season && floor == &data.floor_A)
+		{
+			floor = &data.floor_B;
+			season_pollock.assign(season_pollock.size(), 0);
+			season_chinook.assign(season_chinook.size(), 0);
+			worst_rate.clear();
+			sector_pollock = 0;
+			sector_chinook = 0;
+		}
+		if(floor->date < 0)
+		{
+			if(index >= season_pollock.size())
+			{
+				season_pollock.resize(index + 1, 0);
+				season_chinook.resize(index + 1, 0);
+			}
+			// vessel chinook is truncated and the sector's rounded, as in the floor price program
+			season_pollock[index] += year_data[i].pollock;
+			season_chinook[index] += int(year_data[i].chinook);
+			sector_pollock += year_data[i].pollock;
+			sector_chinook += int(year_data[i].chinook+0.5);
+			worst_rate.set(index, season_chinook[index] / season_pollock[index]);
+			if(sector_chinook >= FLOOR_PRICE_CHINOOK)
+			{
+				floor->date = day + data.start_date;
+				floor->sector_rate = sector_chinook / sector_pollock;
+				floor->worst_rate = worst_rate.max();
+			}
 		}
 	}
 	
+	// hauls go to the last vessel added under their name
+	for(int i = 0; i < num_data; i++)
+		data.haul_vessel[i] = vessel_of_name[year_data[i].name];
+	
+	// season pollock for each vessel
+	for(int j = 0; j < vessel_years.size(); j++)
+	{
+		vessel_year & v = vessel_years[j];
+		v.daily.accumulate(start_b_season);
+		v.pollock_A = 0;
+		v.pollock_B = 0;
+		for(int k = 0; k < v.daily.size(); k++)
+		{
+			if(v.daily.days[k] < start_b_season)
+				v.pollock_A += v.daily.pollock[k];
+			else
+				v.pollock_B += v.daily.pollock[k];
+		}
+		v.pollock_total = v.pollock_A + v.pollock_B;
+	}
 	return;
 }
 
+// the replay data for a year, built on first use
+year_dataset_ptr simulator::load_year(const int year)
+{
+	map<int, year_dataset_ptr>::iterator found = year_sets.find(year);
+	if(found != year_sets.end())
+		return found->second;
+	
+	shared_ptr<year_dataset> data(new year_dataset);
+	convert_data(raw_data, year, *data);
+	year_sets[year] = data;
+	return data;
+}
+
+// start a scenario's year on the shared data, with a fresh record for each vessel
+void simulator::begin_year(const year_dataset_ptr & data, vector<vessel> & vessel_data)
+{
+	year_set = data;
+	start_date = data->start_date;
+	num_days = data->num_days;
+	vessel_data.assign(data->vessels.size(), vessel());
+	states.resize(data->vessels.size());
+	return;
+}
+
+vector<vessel_state> & simulator::get_vessel_states()
+{
+	return states;
+}
+
+// fleet totals and credit pools where the replay stopped
+fleet_state simulator::get_fleet_state() const
+{
+	fleet_state f = fleet;
+	f.credits_available = from_credit_units(credits_available);
+	f.credits_held = from_credit_units(credits_held);
+	f.credits_transferred = from_credit_units(credits_transferred);
+	return f;
+}
+
 void simulator::load_credit_factors(vector<vessel> & vessel_data)
 {
+	PROFILE_SCOPE("load_credit_factors");
+	credit_factor_db & factor_DB = mutable_credit_factors();
+	const vector<vessel_year> & vessel_years = year_set->vessels;
 	int num_vessels = vessel_data.size();
-	int DB_size = credit_factor_DB.size();
-	int found;
-	credit_factor new_credit_factor;
+	int id;
 	
 	for(int i = 0; i < num_vessels; i++)
 	{
-		found = -1;
-		for(int j = 0; j < DB_size; j++)
-		{
-			if ((vessel_data[i].name.compare(credit_factor_DB[j].name) == 0) && 
-				(vessel_data[i].coop.compare(credit_factor_DB[j].coop) == 0))
-			{
-				found = j;
-				break;
-			}
-		}
-		if(found < 0)
-		{
-			new_credit_factor.name = vessel_data[i].name;
-			new_credit_factor.coop = vessel_data[i].coop;
-			new_credit_factor.p_A.assign(1, 1);
-			new_credit_factor.p_B.assign(1, 1);
-			new_credit_factor.q_A.assign(1, 1);
-			new_credit_factor.q_B.assign(1, 1);
-			new_credit_factor.cim_A = 1;
-			new_credit_factor.cim_B = 1;
-			
-			found = credit_factor_DB.size();
-			credit_factor_DB.push_back(new_credit_factor);
-		}
+		id = vessel_years[i].id;
+		if(!factor_DB.contains(id))
+			factor_DB.add(id);
 		
 		vessel_data[i].credit_factor_A = ALPHA + 
-		BETA * credit_factor_DB[found].p_A.back() + 
-		GAMMA * credit_factor_DB[found].q_A.back();
+		BETA * factor_DB.p_A[id] + 
+		GAMMA * factor_DB.q_A[id];
 		vessel_data[i].credit_factor_B = ALPHA + 
-		BETA * credit_factor_DB[found].p_B.back() + 
-		GAMMA * credit_factor_DB[found].q_B.back();
-		vessel_data[i].cim_A = credit_factor_DB[found].cim_A;
-		vessel_data[i].cim_B = credit_factor_DB[found].cim_B;
+		BETA * factor_DB.p_B[id] + 
+		GAMMA * factor_DB.q_B[id];
+		vessel_data[i].cim_A = factor_DB.cim_A[id];
+		vessel_data[i].cim_B = factor_DB.cim_B[id];
 	}
 	return;
 }
 
 void simulator::process_data(vector<vessel> & vessel_data, const int year)
 {
+	PROFILE_SCOPE("process_data");
 	int num_vessels;
 	num_vessels = vessel_data.size();
 	double pollock_left;
@@ -323,79 +438,80 @@ void simulator::process_data(vector<vessel> & vessel_data, const int year)
 	
 	int start_b_season = day_count(year, 6, 11) - start_date;
 	
-	// compute totals for A season
+	// fleet totals for each day are gathered from the days each vessel fished
+	// and summed to date afterwards; only the cumulative pollock is needed
+	// when no sink reads the rest
+	bool daily_totals = output_needs & DAILY_TOTALS;
+	day_pollock.assign(num_days, 0);
+	day_chinook.assign(num_days, 0);
+	day_chinook_std.assign(num_days, 0);
+	
+	// compute season totals
 	season_pollock_A = 0;
 	season_chinook_A = 0;
-	for(int i = 0; i < num_vessels; i++)
-	{
-		vessel_data[i].pollock_A = vessel_data[i].pollock[0];
-		vessel_data[i].chinook_A = vessel_data[i].cim_A * vessel_data[i].chinook[0];
-		vessel_data[i].pollock_std[0] = vessel_data[i].pollock[0];
-		vessel_data[i].chinook_std[0] = vessel_data[i].cim_A * vessel_data[i].chinook[0];
-		
-		for(int j = 1; j < start_b_season; j++)
-		{
-			vessel_data[i].pollock_A += vessel_data[i].pollock[j];
-			vessel_data[i].chinook_A += vessel_data[i].cim_A * vessel_data[i].chinook[j];
-			
-			vessel_data[i].pollock_std[j] = vessel_data[i].pollock_std[j-1] + vessel_data[i].pollock[j];
-			vessel_data[i].chinook_std[j] = vessel_data[i].chinook_std[j-1] + vessel_data[i].cim_A * vessel_data[i].chinook[j];
-		}
-		season_pollock_A += vessel_data[i].pollock_A;
-		season_chinook_A += vessel_data[i].chinook_A;
-		
-		vessel_data[i].bycatch_rate_A = vessel_data[i].chinook_A / vessel_data[i].pollock_A;
-	}
-	
-	// compute totals for B season
 	season_pollock_B = 0;
 	season_chinook_B = 0;
+	const vector<vessel_year> & vessel_years = year_set->vessels;
 	for(int i = 0; i < num_vessels; i++)
 	{
-		vessel_data[i].pollock_B = vessel_data[i].pollock[start_b_season];
-		vessel_data[i].chinook_B = vessel_data[i].cim_B * vessel_data[i].chinook[start_b_season];
-		vessel_data[i].pollock_std[start_b_season] = vessel_data[i].pollock[start_b_season];
-		vessel_data[i].chinook_std[start_b_season] = vessel_data[i].cim_B * vessel_data[i].chinook[start_b_season];
+		vessel & v = vessel_data[i];
+		const vessel_year & landed = vessel_years[i];
+		const catch_series & daily = landed.daily;
+		int num_fished = daily.size();
+		v.chinook_A = 0;
+		v.chinook_B = 0;
 		
-		for(int j = start_b_season+1; j < num_days; j++)
+		for(int k = 0; k < num_fished; k++)
 		{
-			vessel_data[i].pollock_B += vessel_data[i].pollock[j];
-			vessel_data[i].chinook_B += vessel_data[i].cim_B * vessel_data[i].chinook[j];
-			
-			vessel_data[i].pollock_std[j] = vessel_data[i].pollock_std[j-1] + vessel_data[i].pollock[j];
-			vessel_data[i].chinook_std[j] = vessel_data[i].chinook_std[j-1] + vessel_data[i].cim_B * vessel_data[i].chinook[j];
+			int day = daily.days[k];
+			int chinook_counted;
+			if(day < start_b_season)
+			{
+				chinook_counted = int(v.cim_A * daily.chinook[k]);
+				v.chinook_A += chinook_counted;
+			}
+			else
+			{
+				chinook_counted = int(v.cim_B * daily.chinook[k]);
+				v.chinook_B += chinook_counted;
+			}
+			day_pollock[day] += daily.pollock[k];
+			if(daily_totals)
+			{
+				day_chinook[day] += daily.chinook[k];
+				day_chinook_std[day] += chinook_counted;
+			}
 		}
-		season_pollock_B += vessel_data[i].pollock_B;
-		season_chinook_B += vessel_data[i].chinook_B;
+		season_pollock_A += landed.pollock_A;
+		season_chinook_A += v.chinook_A;
+		season_pollock_B += landed.pollock_B;
+		season_chinook_B += v.chinook_B;
 		
-		vessel_data[i].bycatch_rate_B = vessel_data[i].chinook_B / vessel_data[i].pollock_B;
-		vessel_data[i].pollock_total = vessel_data[i].pollock_A + vessel_data[i].pollock_B;
-		vessel_data[i].chinook_total = vessel_data[i].chinook_A + vessel_data[i].chinook_B;
-		vessel_data[i].bycatch_rate_total = vessel_data[i].chinook_total / vessel_data[i].pollock_total;
+		v.bycatch_rate_A = v.chinook_A / landed.pollock_A;
+		v.bycatch_rate_B = v.chinook_B / landed.pollock_B;
+		v.chinook_total = v.chinook_A + v.chinook_B;
+		v.bycatch_rate_total = v.chinook_total / landed.pollock_total;
 	}
 	
-	double pollock_std;
-	for(int j = start_b_season+1; j < num_days; j++)
-	{
-		pollock_std = 0;
-		for(int i = 0; i < num_vessels; i++)
-		{
-			pollock_std += vessel_data[i].pollock_std[j];
-		}
-		if(pollock_std >= 2.0 / 3.0 * season_pollock_B)
-		{
-			SSR_set_date = j;
-			break;
-		}
-	}
+	// fleet totals to date, starting over with the B season
+	day_pollock_std = day_pollock;
+	prefix_sum(day_pollock_std.data(), start_b_season);
+	prefix_sum(day_pollock_std.data() + start_b_season, num_days - start_b_season);
+	prefix_sum(day_chinook_std.data(), start_b_season);
+	prefix_sum(day_chinook_std.data() + start_b_season, num_days - start_b_season);
+	
+	int SSR_day = start_b_season + 1 + first_at_least(day_pollock_std.data() + start_b_season + 1, 
+													   num_days - start_b_season - 1, 2.0 / 3.0 * season_pollock_B);
+	if(SSR_day < num_days)
+		SSR_set_date = SSR_day;
 	
 	// compute credit allocations
 	double total_credit_perc_A = 0;
 	double total_credit_perc_B = 0;
 	for(int i = 0; i < num_vessels; i++)
 	{
-		vessel_data[i].credit_perc_A = vessel_data[i].pollock_A / season_pollock_A * vessel_data[i].credit_factor_A;
-		vessel_data[i].credit_perc_B = vessel_data[i].pollock_B / season_pollock_B * vessel_data[i].credit_factor_B;
+		vessel_data[i].credit_perc_A = vessel_years[i].pollock_A / season_pollock_A * vessel_data[i].credit_factor_A;
+		vessel_data[i].credit_perc_B = vessel_years[i].pollock_B / season_pollock_B * vessel_data[i].credit_factor_B;
 		total_credit_perc_A += vessel_data[i].credit_perc_A;
 		total_credit_perc_B += vessel_data[i].credit_perc_B;
 	}
@@ -434,25 +550,24 @@ void simulator::process_data(vector<vessel> & vessel_data, const int year)
 	return;
 }
 
-void simulator::simulate_year(vector<vessel> & vessel_data, const int year, 
-							  const vector<landing> & year_data)
+void simulator::simulate_year(vector<vessel> & vessel_data, const int year)
 {
 	int num_vessels = vessel_data.size();
 	
 	// initialize vessel data
 	for(int i = 0; i < num_vessels; i++)
 	{
-		vessel_data[i].credits = vessel_data[i].init_credits_A;
-		vessel_data[i].actual_pollock_A = 0;
-		vessel_data[i].actual_pollock_B = 0;
-		vessel_data[i].actual_chinook_A = 0;
-		vessel_data[i].actual_chinook_B = 0;
-		vessel_data[i].out_date_A = 9999;
-		vessel_data[i].out_date_B = 9999;
-		vessel_data[i].hit_A_limit = false;
-		vessel_data[i].hit_B_limit = false;
-		vessel_data[i].done_A = false;
-		vessel_data[i].done_B = false;
+		states[i].credits = vessel_data[i].init_credits_A;
+		states[i].actual_pollock_A = 0;
+		states[i].actual_pollock_B = 0;
+		states[i].actual_chinook_A = 0;
+		states[i].actual_chinook_B = 0;
+		states[i].out_date_A = 9999;
+		states[i].out_date_B = 9999;
+		states[i].hit_A_limit = false;
+		states[i].hit_B_limit = false;
+		states[i].done_A = false;
+		states[i].done_B = false;
 	}
 	
 	SSR_set = false;
@@ -461,34 +576,86 @@ void simulator::simulate_year(vector<vessel> & vessel_data, const int year,
 	credits_held = 0;
 	credits_transferred = 0;
 	
-	simulate_A_season(vessel_data, year, year_data);
-	simulate_B_season(vessel_data, year, year_data);
+	reset_fleet_state();
+	fleet_series.clear();
+	
+	for(int e = 0; e < NUM_CHECKPOINTS; e++)
+		checkpoints[e].valid = false;
+	save_checkpoint(YEAR_START, 'A', 0, -1, -1);
+	resume_event = NUM_CHECKPOINTS;
+	
+	simulate_A_season(vessel_data, year);
+	begin_B_season(vessel_data);
+	simulate_B_season(vessel_data);
+	
+	finish_year(vessel_data, year);
+	return;
+}
+
+void simulator::resimulate_year(vector<vessel> & vessel_data, const int year)
+{
+	// nothing downstream has changed since the last replay
+	if(resume_event >= NUM_CHECKPOINTS)
+		return;
+	
+	// resume from the latest snapshot that the changed parameters do not affect
+	int event = resume_event;
+	while(event > YEAR_START && !checkpoints[event].valid)
+		event--;
+	sim_checkpoint & cp = checkpoints[event];
+	restore_checkpoint(CheckpointEvent(event));
+	
+	if(cp.pending_vessel >= 0)
+		bank_unused_credits(states[cp.pending_vessel]);
+	if(cp.season == 'A')
+	{
+		simulate_A_season(vessel_data, year, cp.data_index, cp.prev_day);
+		begin_B_season(vessel_data);
+		simulate_B_season(vessel_data);
+	}
+	else
+	{
+		simulate_B_season(vessel_data, cp.data_index, cp.prev_day);
+	}
+	resume_event = NUM_CHECKPOINTS;
+	
+	finish_year(vessel_data, year);
+	return;
+}
+
+void simulator::finish_year(vector<vessel> & vessel_data, const int year)
+{
+	const vector<vessel_year> & vessel_years = year_set->vessels;
+	int num_vessels = vessel_data.size();
+	bool uncaught = output_needs & (VESSEL_TABLE | UNFISHED_TOTALS);
 	
 	// compute lost revenue and bycatch rate
 	for(int i = 0; i < num_vessels; i++)
 	{
-		vessel_data[i].uncaught_pollock_A = vessel_data[i].pollock_A - vessel_data[i].actual_pollock_A;
-		if (vessel_data[i].pollock_A > 0)
-			vessel_data[i].actual_bycatch_rate_A = vessel_data[i].actual_chinook_A / vessel_data[i].actual_pollock_A;
-		
-		vessel_data[i].uncaught_pollock_B = vessel_data[i].pollock_B - vessel_data[i].actual_pollock_B;
-		if (vessel_data[i].pollock_B > 0)
-			vessel_data[i].actual_bycatch_rate_B = vessel_data[i].actual_chinook_B / vessel_data[i].actual_pollock_B;
+		if(uncaught)
+		{
+			vessel_data[i].uncaught_pollock_A = vessel_years[i].pollock_A - states[i].actual_pollock_A;
+			vessel_data[i].uncaught_pollock_B = vessel_years[i].pollock_B - states[i].actual_pollock_B;
+		}
+		if (vessel_years[i].pollock_A > 0)
+			vessel_data[i].actual_bycatch_rate_A = states[i].actual_chinook_A / states[i].actual_pollock_A;
+		if (vessel_years[i].pollock_B > 0)
+			vessel_data[i].actual_bycatch_rate_B = states[i].actual_chinook_B / states[i].actual_pollock_B;
 	}
-	cerr << "credits transferred for " << year << " = " << credits_transferred << "\n";
+	cerr << "credits transferred for " << year << " = " << from_credit_units(credits_transferred) << "\n";
 	
 	double total_bycatch = 0;
 	double total_init_credits = 0;
 	for(int i = 0; i < num_vessels; i++)
 	{
-		if (vessel_data[i].pollock_A > 0)
+		if (vessel_years[i].pollock_A > 0)
 		{
-			total_bycatch += vessel_data[i].actual_chinook_A;
+			total_bycatch += states[i].actual_chinook_A;
 			total_init_credits += vessel_data[i].init_credits_A;
 		}
-		if (vessel_data[i].pollock_B > 0)
+		if (vessel_years[i].pollock_B > 0)
 		{
-			total_bycatch += vessel_data[i].actual_chinook_B;
+			total_bycatch += states[i].actual_chinook_B;
 			total_init_credits += vessel_data[i].init_credits_B;
 		}
 	}
@@ -496,26 +663,37 @@ void simulator::simulate_year(vector<vessel> & vessel_data, const int year,
 	cerr << "original total bycatch = " << season_chinook_A + season_chinook_B << "\n";
 	cerr << "target level = " << TARGET_CAP * (A_SEASON_FRAC * A_SEASON_CV_FRAC + B_SEASON_FRAC * B_SEASON_CV_FRAC) << "\n";
 	cerr << "credits distributed = " << total_init_credits << "\n";
-	cerr << "credits held = " << credits_held << "\n";
+	cerr << "credits held = " << from_credit_units(credits_held) << "\n";
 	cerr << "\n";
+	
+	if(!(output_needs & YEAR_SUMMARY))
+		return;
+	current_summary.year = year;
+	current_summary.target_level = TARGET_CAP * (A_SEASON_FRAC * A_SEASON_CV_FRAC + B_SEASON_FRAC * B_SEASON_CV_FRAC);
+	current_summary.credits_distributed = total_init_credits;
+	current_summary.credits_used = total_bycatch;
+	current_summary.credits_transferred = from_credit_units(credits_transferred);
+	current_summary.credits_held = from_credit_units(credits_held);
+	current_summary.original_bycatch = season_chinook_A + season_chinook_B;
 	return;
 }
 
 void simulator::simulate_A_season(vector<vessel> & vessel_data, const int year, 
-								  const vector<landing> & year_data)
+								  const int first_index, int prev_day)
 {
+	PROFILE_SCOPE("simulate_A_season");
+	const year_dataset & data = *year_set;
+	const vector<landing> & year_data = data.hauls;
+	const vector<vessel_year> & vessel_years = data.vessels;
 	int num_data = year_data.size();
-	int num_vessels = vessel_data.size();
 	int b_season_start_date = day_count(year, 6, 11) - start_date;
 	int day_index, index;
 	double fishable_ratio;
-	int prev_day;
-	int credits_needed, unused_credits;
+	int credits_needed;
 
-	prev_day = -1;
-	for(int i = 0; i < num_data; i++)
+	for(int i = first_index; i < num_data; i++)
 	{
-		day_index = day_count(year, year_data[i].month, year_data[i].day) - start_date;
+		day_index = data.haul_day[i];
 		
 		// stop when at b_season
 		if(day_index >= b_season_start_date)
@@ -527,108 +705,111 @@ void simulator::simulate_A_season(vector<vessel> & vessel_data, const int year,
 		// transfer credits if possible to cleanest vessels that need credits
 		if(day_index != prev_day)
 		{
-			transfer_credits(vessel_data, year, year_data, i, day_index);
+			if(prev_day >= 0)
+				record_fleet_day(prev_day);
+			transfer_credits(vessel_data, i, day_index);
 			prev_day = day_index;
 		}
 		
-		index = vessel_index[year_data[i].name];
+		index = data.haul_vessel[i];
+		PROFILE_COUNT("vessel lookups", 1);
+		PROFILE_COUNT("hauls A", 1);
 		
-		if(vessel_data[index].credits > 0) // able to fish
+		if(states[index].credits > 0) // able to fish
 		{
 			credits_needed = int(vessel_data[index].cim_A * year_data[i].chinook + 0.5);
-			if(credits_needed > vessel_data[index].credits) // if not enough ITEC for this haul, use fractional haul
+			if(credits_needed > states[index].credits) // if not enough ITEC for this haul, use fractional haul
 			{
-				fishable_ratio = double(vessel_data[index].credits) / credits_needed;
-				vessel_data[index].actual_pollock_A += fishable_ratio * year_data[i].pollock;
-				vessel_data[index].actual_chinook_A += vessel_data[index].credits;
-				vessel_data[index].credits = 0;
+				fishable_ratio = double(states[index].credits) / credits_needed;
+				states[index].actual_pollock_A += fishable_ratio * year_data[i].pollock;
+				states[index].actual_chinook_A += states[index].credits;
+				fleet.actual_pollock_A += fishable_ratio * year_data[i].pollock;
+				fleet.actual_chinook_A += states[index].credits;
+				set_credits(states[index], 0);
 			}
 			else // use entire haul
 			{
-				vessel_data[index].actual_pollock_A += year_data[i].pollock;
-				vessel_data[index].actual_chinook_A += credits_needed;
-				vessel_data[index].credits -= credits_needed;
+				states[index].actual_pollock_A += year_data[i].pollock;
+				states[index].actual_chinook_A += credits_needed;
+				fleet.actual_pollock_A += year_data[i].pollock;
+				fleet.actual_chinook_A += credits_needed;
+				set_credits(states[index], states[index].credits - credits_needed);
 			}
 		}
 		/*
-		 if(!vessel_data[index].hit_A_limit) // check if vessel ran out
+		 if(!states[index].hit_A_limit) // check if vessel ran out
 		 {
-		 if(vessel_data[index].credits < 0) // out of credits
+		 if(states[index].credits < 0) // out of credits
 		 {
-		 vessel_data[index].out_date_A = day_index;
-		 vessel_data[index].hit_A_limit = true;
+		 states[index].out_date_A = day_index;
+		 states[index].hit_A_limit = true;
 		 }
-		 else if(vessel_data[index].credits == 0 && vessel_data[index].pollock_A > vessel_data[index].pollock_std[day_index])
+		 else if(states[index].credits == 0 && vessel_years[index].pollock_A > vessel_years[index].daily.pollock_to_date(day_index))
 		 {
-		 vessel_data[index].out_date_A = day_index;
-		 vessel_data[index].hit_A_limit = true;
+		 states[index].out_date_A = day_index;
+		 states[index].hit_A_limit = true;
 		 }
 		 }
 		 */
 		
 		// handle vessel completion of A season fishing
-		if(!vessel_data[index].done_A && 
-		   vessel_data[index].pollock_std[day_index] > (vessel_data[index].pollock_A - 0.01)) // done fishing by this date
+		if(!states[index].done_A && 
+		   vessel_years[index].daily.pollock_to_date(day_index) > (vessel_years[index].pollock_A - 0.01)) // done fishing by this date
 		{
-			vessel_data[index].done_A = true; // ok, we are done counting this vessel
-			unused_credits = vessel_data[index].credits;
-			// cerr << vessel_data[index].name << " finished fishing ";
-			// cerr << "with " << unused_credits << " credits remaining\n";
-			switch(trading_rule)
-			{
-				case DYNAMIC_SALMON_SAVINGS:
-					credits_available += unused_credits * (1 - stranding_rate);
-					credits_held += unused_credits * stranding_rate;
-					break;
-				case FIXED_TRANSFER_TAX:
-					credits_available += unused_credits * (1 - TAX_RATE);
-					credits_held += unused_credits * TAX_RATE;
-					break;
-			}
-			vessel_data[index].credits = 0;
+			states[index].done_A = true; // ok, we are done counting this vessel
+			// cerr << vessel_years[index].name << " finished fishing ";
+			// cerr << "with " << states[index].credits << " credits remaining\n";
+			if(!checkpoints[FIRST_COMPLETION].valid)
+				save_checkpoint(FIRST_COMPLETION, 'A', i + 1, prev_day, index);
+			bank_unused_credits(states[index]);
 		}
 	}
+	if(prev_day >= 0)
+		record_fleet_day(prev_day);
 	
 	return;
 }
 
-void simulator::simulate_B_season(vector<vessel> & vessel_data, const int year, 
-								  const vector<landing> & year_data)
+void simulator::begin_B_season(vector<vessel> & vessel_data)
 {
-	int num_data = year_data.size();
 	int num_vessels = vessel_data.size();
-	int b_season_start_date = day_count(year, 6, 11) - start_date;
-	int day_index, index;
-	double fishable_ratio;
-	int prev_day;
-	int credits_needed, unused_credits;
 	
 	// influx of B season credits
 	for(int i = 0; i < num_vessels; i++)
 	{
-		if(vessel_data[i].credits < 0)
-			vessel_data[i].credits = 0;
-		vessel_data[i].credits += vessel_data[i].init_credits_B;
-	}	
+		if(states[i].credits < 0)
+			states[i].credits = 0;
+		states[i].credits += vessel_data[i].init_credits_B;
+	}
+	reset_fleet_state();
+	return;
+}
+
+void simulator::simulate_B_season(vector<vessel> & vessel_data, const int first_index, int prev_day)
+{
+	PROFILE_SCOPE("simulate_B_season");
+	const year_dataset & data = *year_set;
+	const vector<landing> & year_data = data.hauls;
+	const vector<vessel_year> & vessel_years = data.vessels;
+	int num_data = year_data.size();
+	int day_index, index;
+	double fishable_ratio;
+	int credits_needed;
 	
-	prev_day = -1;
 	double expected_credits, chinook_std;
-	double new_credits_held, credit_supply;
-	for(int i = b_season_first_catch; i < num_data; i++)
+	double credit_supply;
+	credit_units new_credits_held;
+	for(int i = (first_index < 0 ? b_season_first_catch : first_index); i < num_data; i++)
 	{
-		day_index = day_count(year, year_data[i].month, year_data[i].day) - start_date;
+		day_index = data.haul_day[i];
 		
 		// set SSR if needed
 		if(trading_rule == DYNAMIC_SALMON_SAVINGS && !SSR_set && day_index == SSR_set_date)
 		{
+			save_checkpoint(SSR_DATE, 'B', i, prev_day, -1);
 			SSR_set = true;
-			chinook_std = 0;
-			credit_supply = credits_available;
-			for(int j = 0; j < num_vessels; j++)
-			{
-				chinook_std += vessel_data[j].actual_chinook_B;
-				credit_supply += vessel_data[j].credits;
-			}
+			chinook_std = fleet.actual_chinook_B;
+			credit_supply = from_credit_units(credits_available) + fleet.credits;
 			expected_credits = chinook_std * 9 + 5000;
 			/*
 			cerr << "for " << year << ":\n";
@@ -649,7 +830,7 @@ void simulator::simulate_B_season(vector<vessel> & vessel_data, const int year,
 					stranding_rate = DYNAMIC_STRANDING_LIMIT;
 				else // correct for previous withholding
 				{
-					new_credits_held = credits_held / DYNAMIC_STRANDING_LIMIT * stranding_rate;
+					new_credits_held = split_credit_units(credits_held, stranding_rate / DYNAMIC_STRANDING_LIMIT);
 					credits_available += (credits_held - new_credits_held);
 					credits_held = new_credits_held;
 				}
@@ -661,248 +842,373 @@ void simulator::simulate_B_season(vector<vessel> & vessel_data, const int year,
 		// transfer credits if possible to cleanest vessels that need credits
 		if(day_index != prev_day)
 		{
-			transfer_credits(vessel_data, year, year_data, i, day_index);
+			if(prev_day >= 0)
+				record_fleet_day(prev_day);
+			transfer_credits(vessel_data, i, day_index);
 			prev_day = day_index;
 		}
 		
-		index = vessel_index[year_data[i].name];
+		index = data.haul_vessel[i];
+		PROFILE_COUNT("vessel lookups", 1);
+		PROFILE_COUNT("hauls B", 1);
 		
-		if(vessel_data[index].credits > 0) // able to fish
+		if(states[index].credits > 0) // able to fish
 		{
 			credits_needed = int(vessel_data[index].cim_B * year_data[i].chinook + 0.5);
-			if(credits_needed > vessel_data[index].credits) // if not enough ITEC for this haul, use fractional haul
+			if(credits_needed > states[index].credits) // if not enough ITEC for this haul, use fractional haul
 			{
-				fishable_ratio = double(vessel_data[index].credits) / credits_needed;
-				vessel_data[index].actual_pollock_B += fishable_ratio * year_data[i].pollock;
-				vessel_data[index].actual_chinook_B += vessel_data[index].credits;
-				vessel_data[index].credits = 0;
+				fishable_ratio = double(states[index].credits) / credits_needed;
+				states[index].actual_pollock_B += fishable_ratio * year_data[i].pollock;
+				states[index].actual_chinook_B += states[index].credits;
+				fleet.actual_pollock_B += fishable_ratio * year_data[i].pollock;
+				fleet.actual_chinook_B += states[index].credits;
+				set_credits(states[index], 0);
 			}
 			else // use entire haul
 			{
-				vessel_data[index].actual_pollock_B += year_data[i].pollock;
-				vessel_data[index].actual_chinook_B += credits_needed;
-				vessel_data[index].credits -= credits_needed;
+				states[index].actual_pollock_B += year_data[i].pollock;
+				states[index].actual_chinook_B += credits_needed;
+				fleet.actual_pollock_B += year_data[i].pollock;
+				fleet.actual_chinook_B += credits_needed;
+				set_credits(states[index], states[index].credits - credits_needed);
 			}
 		}
 		/*
-		 if(!vessel_data[index].hit_B_limit) // check if vessel ran out
+		 if(!states[index].hit_B_limit) // check if vessel ran out
 		 {
-		 if(vessel_data[index].credits < 0) // out of credits
+		 if(states[index].credits < 0) // out of credits
 		 {
-		 vessel_data[index].out_date_B = day_index;
-		 vessel_data[index].hit_B_limit = true;
+		 states[index].out_date_B = day_index;
+		 states[index].hit_B_limit = true;
 		 }
-		 else if(vessel_data[index].credits == 0 && vessel_data[index].pollock_B > vessel_data[index].pollock_std[day_index])
+		 else if(states[index].credits == 0 && vessel_years[index].pollock_B > vessel_years[index].daily.pollock_to_date(day_index))
 		 {
-		 vessel_data[index].out_date_B = day_index;
-		 vessel_data[index].hit_B_limit = true;
+		 states[index].out_date_B = day_index;
+		 states[index].hit_B_limit = true;
 		 }
 		 }
 		 */
 		
 		// handle vessel completion of B season fishing
-		if(!vessel_data[index].done_B && 
-		   vessel_data[index].pollock_std[day_index] > (vessel_data[index].pollock_B - 0.01)) // done fishing by this date
+		if(!states[index].done_B && 
+		   vessel_years[index].daily.pollock_to_date(day_index) > (vessel_years[index].pollock_B - 0.01)) // done fishing by this date
 		{
-			vessel_data[index].done_B = true; // ok, we are done counting this vessel
-			unused_credits = vessel_data[index].credits;
-			// cerr << vessel_data[index].name << " finished fishing ";
-			// cerr << "with " << unused_credits << " credits remaining\n";
-			switch(trading_rule)
-			{
-				case DYNAMIC_SALMON_SAVINGS:
-					credits_available += unused_credits * (1 - stranding_rate);
-					credits_held += unused_credits * stranding_rate;
-					break;
-				case FIXED_TRANSFER_TAX:
-					credits_available += unused_credits * (1 - TAX_RATE);
-					credits_held += unused_credits * TAX_RATE;
-					break;
-			}
-			vessel_data[index].credits = 0;
+			states[index].done_B = true; // ok, we are done counting this vessel
+			// cerr << vessel_years[index].name << " finished fishing ";
+			// cerr << "with " << states[index].credits << " credits remaining\n";
+			if(!checkpoints[FIRST_COMPLETION].valid)
+				save_checkpoint(FIRST_COMPLETION, 'B', i + 1, prev_day, index);
+			bank_unused_credits(states[index]);
 		}
 	}
+	if(prev_day >= 0)
+		record_fleet_day(prev_day);
 	return;
 }
 
-void simulator::update_credit_factors(vector<vessel> & vessel_data)
+void simulator::bank_unused_credits(vessel_state & v)
 {
-	int num_vessels = vessel_data.size();
-	int DB_size = credit_factor_DB.size();
+	credit_units unused_credits = to_credit_units(v.credits);
+	credit_units withheld = 0;
+	switch(trading_rule)
+	{
+		case DYNAMIC_SALMON_SAVINGS:
+			withheld = split_credit_units(unused_credits, stranding_rate);
+			break;
+		case FIXED_TRANSFER_TAX:
+			withheld = split_credit_units(unused_credits, TAX_RATE);
+			break;
+	}
+	credits_available += unused_credits - withheld;
+	credits_held += withheld;
+	set_credits(v, 0);
+	return;
+}
+
+void simulator::set_credits(vessel_state & v, const int credits)
+{
+	fleet.credits += credits - v.credits;
+	fleet.vessels_out += (credits <= 0) - (v.credits <= 0);
+	v.credits = credits;
+	return;
+}
+
+// recount the running totals from the vessels
+void simulator::reset_fleet_state()
+{
+	int num_vessels = states.size();
+	fleet.credits = 0;
+	fleet.vessels_out = 0;
+	fleet.actual_pollock_A = 0;
+	fleet.actual_pollock_B = 0;
+	fleet.actual_chinook_A = 0;
+	fleet.actual_chinook_B = 0;
+	for(int i = 0; i < num_vessels; i++)
+	{
+		fleet.credits += states[i].credits;
+		if(states[i].credits <= 0)
+			fleet.vessels_out++;
+		fleet.actual_pollock_A += states[i].actual_pollock_A;
+		fleet.actual_pollock_B += states[i].actual_pollock_B;
+		fleet.actual_chinook_A += states[i].actual_chinook_A;
+		fleet.actual_chinook_B += states[i].actual_chinook_B;
+	}
+	return;
+}
+
+// close out a day of the replay in the fleet series
+void simulator::record_fleet_day(const int day)
+{
+	if(!record_fleet_series)
+		return;
+	fleet.day = day;
+	fleet.credits_available = from_credit_units(credits_available);
+	fleet.credits_held = from_credit_units(credits_held);
+	fleet.credits_transferred = from_credit_units(credits_transferred);
+	fleet_series.push_back(fleet);
+	return;
+}
+
+void simulator::save_checkpoint(const CheckpointEvent event, const char season, const int data_index, 
+								const int prev_day, const int pending_vessel)
+{
+	sim_checkpoint & cp = checkpoints[event];
+	
+	// the vector keeps its capacity across years, so this does not allocate in steady state
+	cp.states.assign(states.begin(), states.end());
+	cp.credits_available = credits_available;
+	cp.credits_held = credits_held;
+	cp.credits_transferred = credits_transferred;
+	cp.stranding_rate = stranding_rate;
+	cp.SSR_set = SSR_set;
+	cp.fleet = fleet;
+	cp.num_fleet_days = fleet_series.size();
+	cp.season = season;
+	cp.data_index = data_index;
+	cp.prev_day = prev_day;
+	cp.pending_vessel = pending_vessel;
+	cp.valid = true;
+	return;
+}
+
+void simulator::restore_checkpoint(const CheckpointEvent event)
+{
+	const sim_checkpoint & cp = checkpoints[event];
+	
+	states.assign(cp.states.begin(), cp.states.end());
+	credits_available = cp.credits_available;
+	credits_held = cp.credits_held;
+	credits_transferred = cp.credits_transferred;
+	stranding_rate = cp.stranding_rate;
+	SSR_set = cp.SSR_set;
+	fleet = cp.fleet;
+	if(fleet_series.size() > cp.num_fleet_days)
+		fleet_series.resize(cp.num_fleet_days);
+	
+	// later snapshots are re-recorded by the replay
+	for(int e = event + 1; e < NUM_CHECKPOINTS; e++)
+		checkpoints[e].valid = false;
+	return;
+}
+
+void simulator::set_tax_rate(const double rate)
+{
+	TAX_RATE = rate;
+	
+	// the tax only applies once the first vessel pools its credits
+	if(trading_rule == FIXED_TRANSFER_TAX && resume_event > FIRST_COMPLETION)
+		resume_event = FIRST_COMPLETION;
+	return;
+}
+
+void simulator::set_stranding_limit(const double limit)
+{
+	DYNAMIC_STRANDING_LIMIT = limit;
 	
-	double mean, var, stdev, adj_stdev, z_score, p, q;
-	double squared_vals, summed_vals, total_pollock;
-	int count, found;
-	double actual_chinook, actual_pollock;
+	// the limit is first read when the SSR is set
+	if(trading_rule == DYNAMIC_SALMON_SAVINGS && resume_event > SSR_DATE)
+		resume_event = SSR_DATE;
+	return;
+}
+
+void simulator::update_credit_factors(vector<vessel> & vessel_data, const int year)
+{
+	PROFILE_SCOPE("update_credit_factors");
+	credit_factor_db & factor_DB = mutable_credit_factors();
+	factor_batch & batch = factor_update;
+	int num_vessels = vessel_data.size();
 	
-	// compute stats for bycatch rate in season A
+	// one pass for the stats of both seasons, packing the fishing vessels of
+	// each season as it goes
+	double summed_vals[2] = {0, 0};
+	double actual_chinook[2] = {0, 0};
+	double actual_pollock[2] = {0, 0};
+	int count[2] = {0, 0};
+	
+	batch.vessel.clear();
+	batch.id.clear();
+	batch.rate.clear();
+	batch.pollock.clear();
+	const vector<vessel_year> & vessel_years = year_set->vessels;
+	for(int s = 0; s < 2; s++)
 	{
-		squared_vals = 0;
-		summed_vals = 0;
-		count = 0;
-		actual_chinook = 0;
-		actual_pollock = 0;
 		for(int i = 0; i < num_vessels; i++)
 		{
-			if(vessel_data[i].pollock_A > 0)
+			const vessel & v = vessel_data[i];
+			const vessel_year & landed = vessel_years[i];
+			if(s == 0)
 			{
-				squared_vals += vessel_data[i].actual_bycatch_rate_A * vessel_data[i].actual_bycatch_rate_A;
-				summed_vals += vessel_data[i].actual_bycatch_rate_A;
-				count ++;
+				actual_pollock[0] += states[i].actual_pollock_A;
+				actual_chinook[0] += states[i].actual_chinook_A;
+				actual_pollock[1] += states[i].actual_pollock_B;
+				actual_chinook[1] += states[i].actual_chinook_B;
 			}
-			actual_pollock += vessel_data[i].actual_pollock_A;
-			actual_chinook += vessel_data[i].actual_chinook_A;
-		}
-		mean = summed_vals / count;
-		var = squared_vals / count - mean * mean;
-		stdev = sqrt(var);
-		stdev = 0.6855 * actual_chinook / actual_pollock;
-		if(mean > bycatch_rate_cap_A)
-			mean = bycatch_rate_cap_A;
-	}
-	for(int i = 0; i < num_vessels; i++)
-	{
-		if(vessel_data[i].pollock_A > 0)
-		{
-			// find vessel
+			if((s == 0 ? landed.pollock_A : landed.pollock_B) > 0)
 			{
-				found = -1;
-				for(int j = 0; j < DB_size; j++)
-				{
-					if ((vessel_data[i].name.compare(credit_factor_DB[j].name) == 0) && 
-						(vessel_data[i].coop.compare(credit_factor_DB[j].coop) == 0))
-					{
-						found = j;
-						break;
-					}
-				}
-				if(found < 0)
+				if(!factor_DB.contains(landed.id))
 				{
 					cerr << "an error has occurred.\n";
 					exit(-1);
 				}
+				batch.vessel.push_back(i);
+				batch.id.push_back(landed.id);
+				batch.rate.push_back(s == 0 ? v.actual_bycatch_rate_A : v.actual_bycatch_rate_B);
+				batch.pollock.push_back(s == 0 ? landed.pollock_A : landed.pollock_B);
+				summed_vals[s] += batch.rate.back();
+				count[s]++;
 			}
-			
-			// compute penalty value
-			{
-				adj_stdev = stdev * sqrt(1 + 1.0/count) / sqrt(1 + vessel_data[i].pollock_A / season_pollock_A);
-				z_score = (mean - vessel_data[i].actual_bycatch_rate_A) / adj_stdev;
-				switch(penalty_func)
-				{
-					case SHALLOW:
-						p = shallow_slope(z_score);
-						break;
-					case NORMAL:
-						p = normal_pvalue(z_score, z_table);
-						break;
-					case MODERATE:
-						p = moderate_slope(z_score);
-						break;
-					case LINEAR:
-						p = linear(z_score);
-						break;
-				}
-				q = EPSILON * p + DELTA;
-			}
-			
-			credit_factor_DB[found].p_A.push_back(vessel_data[i].credit_factor_A);
-			credit_factor_DB[found].q_A.push_back(q);
-			credit_factor_DB[found].cim_A *= (1.0 - PSI / (1.0 + q));
-			vessel_data[i].z_A = z_score;
-			vessel_data[i].q_A = q;
-			vessel_data[i].cim_A = credit_factor_DB[found].cim_A;
 		}
+		if(s == 0)
+			batch.num_A = batch.vessel.size();
 	}
 	
-	// compute stats for bycatch rate in season B
+	// the spread is taken from the fleet-wide rate rather than the variance
+	// of the vessel rates
+	double mean[2], stdev[2], season_pollock[2], shrink[2];
+	const double rate_cap[2] = {bycatch_rate_cap_A, bycatch_rate_cap_B};
+	season_pollock[0] = season_pollock_A;
+	season_pollock[1] = season_pollock_B;
+	for(int s = 0; s < 2; s++)
 	{
-		squared_vals = 0;
-		summed_vals = 0;
-		count = 0;
-		actual_chinook = 0;
-		actual_pollock = 0;
-		for(int i = 0; i < num_vessels; i++)
+		mean[s] = summed_vals[s] / count[s];
+		stdev[s] = 0.6855 * actual_chinook[s] / actual_pollock[s];
+		shrink[s] = sqrt(1 + 1.0/count[s]);
+		if(mean[s] > rate_cap[s])
+			mean[s] = rate_cap[s];
+	}
+	
+	// fused z, penalty, q and cim update over the packed arrays, in blocks so
+	// the penalty lookup stays batched and blocks can run on separate threads
+	const int n = batch.vessel.size();
+	const int num_A = batch.num_A;
+	const int block_size = 256;
+	const int num_blocks = (n + block_size - 1) / block_size;
+	batch.z.resize(n);
+	batch.p.resize(n);
+	batch.q.resize(n);
+	batch.cim.resize(n);
+	
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(num_blocks > 4)
+#endif
+	for(int b = 0; b < num_blocks; b++)
+	{
+		int first = b * block_size;
+		int last = min(first + block_size, n);
+		int s;
+		double adj_stdev;
+		for(int k = first; k < last; k++)
 		{
-			if(vessel_data[i].pollock_B > 0)
-			{
-				squared_vals += vessel_data[i].actual_bycatch_rate_B * vessel_data[i].actual_bycatch_rate_B;
-				summed_vals += vessel_data[i].actual_bycatch_rate_B;
-				count ++;
-			}
-			actual_pollock += vessel_data[i].actual_pollock_B;
-			actual_chinook += vessel_data[i].actual_chinook_B;
+			s = (k >= num_A);
+			adj_stdev = stdev[s] * shrink[s] / sqrt(1 + batch.pollock[k] / season_pollock[s]);
+			batch.z[k] = (mean[s] - batch.rate[k]) / adj_stdev;
+		}
+		evaluate_penalty(&batch.z[first], &batch.p[first], last - first);
+		PROFILE_COUNT("penalty evaluations", last - first);
+		for(int k = first; k < last; k++)
+		{
+			s = (k >= num_A);
+			batch.q[k] = EPSILON * batch.p[k] + DELTA;
+			batch.cim[k] = (s == 0 ? factor_DB.cim_A : factor_DB.cim_B)[batch.id[k]] * (1.0 - PSI / (1.0 + batch.q[k]));
 		}
-		mean = summed_vals / count; // average bycatch rate
-		var = squared_vals / count - mean * mean;
-		stdev = sqrt(var);
-		stdev = 0.6855 * actual_chinook / actual_pollock;
-		if(mean > bycatch_rate_cap_B)
-			mean = bycatch_rate_cap_B;
 	}
 	
-	for(int i = 0; i < num_vessels; i++)
+	// write back to the factor database and the vessels
+	factor_log_record record;
+	record.year = year;
+	for(int k = 0; k < n; k++)
 	{
-		if(vessel_data[i].pollock_B > 0)
+		vessel & v = vessel_data[batch.vessel[k]];
+		int found = batch.id[k];
+		if(k < num_A)
 		{
-			// find vessel
-			{
-				found = -1;
-				for(int j = 0; j < DB_size; j++)
-				{
-					if ((vessel_data[i].name.compare(credit_factor_DB[j].name) == 0) && 
-						(vessel_data[i].coop.compare(credit_factor_DB[j].coop) == 0))
-					{
-						found = j;
-						break;
-					}
-				}
-				if(found < 0)
-				{
-					cerr << "an error has occurred.\n";
-					exit(-1);
-				}
-			}
-			
-			// compute penalty value
-			{
-				adj_stdev = stdev * sqrt(1 + 1.0/count) / sqrt(1 + vessel_data[i].pollock_B / season_pollock_B);
-				z_score = (mean - vessel_data[i].actual_bycatch_rate_B) / adj_stdev;
-				switch(penalty_func)
-				{
-					case SHALLOW:
-						p = shallow_slope(z_score);
-						break;
-					case NORMAL:
-						p = normal_pvalue(z_score, z_table);
-						break;
-					case MODERATE:
-						p = moderate_slope(z_score);
-						break;
-					case LINEAR:
-						p = linear(z_score);
-						break;
-				}
-				q = EPSILON * p + DELTA;
-			}
-			
-			credit_factor_DB[found].p_B.push_back(vessel_data[i].credit_factor_B);
-			credit_factor_DB[found].q_B.push_back(q);
-			credit_factor_DB[found].cim_B *= (1.0 - PSI / (1.0 + q));
-			vessel_data[i].z_B = z_score;
-			vessel_data[i].q_B = q;
-			vessel_data[i].cim_B = credit_factor_DB[found].cim_B;
+			factor_DB.p_A[found] = v.credit_factor_A;
+			factor_DB.q_A[found] = batch.q[k];
+			factor_DB.cim_A[found] = batch.cim[k];
+			v.z_A = batch.z[k];
+			v.q_A = batch.q[k];
+			v.cim_A = batch.cim[k];
+		}
+		else
+		{
+			factor_DB.p_B[found] = v.credit_factor_B;
+			factor_DB.q_B[found] = batch.q[k];
+			factor_DB.cim_B[found] = batch.cim[k];
+			v.z_B = batch.z[k];
+			v.q_B = batch.q[k];
+			v.cim_B = batch.cim[k];
+		}
+		if(factor_history.is_open())
+		{
+			record.vessel_id = found;
+			record.season = (k < num_A) ? 'A' : 'B';
+			record.p = (k < num_A) ? v.credit_factor_A : v.credit_factor_B;
+			record.q = batch.q[k];
+			record.cim = batch.cim[k];
+			factor_history.append(record, vessel_years[batch.vessel[k]].name, vessel_years[batch.vessel[k]].coop);
 		}
 	}
 	return;
 }
 
-void simulator::transfer_credits(vector<vessel> & vessel_data, const int year, const vector<landing> & year_data, const int start_index, const int day_index)
+void simulator::evaluate_penalty(const double * z_scores, double * p_values, const int n)
+{
+	penalty_curves[penalty_func].evaluate(z_scores, p_values, n);
+	return;
+}
+
+bool simulator::load_penalty_curves(const string & filename)
+{
+	return penalty_curves.load(filename);
+}
+
+bool simulator::set_penalty_curve(const string & name)
+{
+	int index = penalty_curves.find(name);
+	if(index < 0)
+	{
+		cerr << "Unknown penalty curve " << name << ".\n";
+		return false;
+	}
+	penalty_func = index;
+	return true;
+}
+
+// index of a named curve for policy_params::penalty_func, or -1
+int simulator::find_penalty_curve(const string & name) const
+{
+	return penalty_curves.find(name);
+}
+
+void simulator::transfer_credits(vector<vessel> & vessel_data, const int start_index, const int day_index)
 {
+	PROFILE_SCOPE("transfer_credits");
+	const year_dataset & data = *year_set;
+	const vector<landing> & year_data = data.hauls;
 	int num_data = year_data.size();
 	int num_vessels = vessel_data.size();
 	int i = start_index;
 	int day, index;
-	vector<needy_struct> needy_db;
 	needy_struct vessel_need;
 	int credits_needed;
 	
@@ -911,43 +1217,48 @@ void simulator::transfer_credits(vector<vessel> & vessel_data, const int year, c
 	
 	// figure out which vessels need credits
 	needy_db.clear();
-	day = day_count(year, year_data[i].month, year_data[i].day) - start_date;
+	day = data.haul_day[i];
 	for(int i = start_index; i < num_data; i++)
 	{
-		day = day_count(year, year_data[i].month, year_data[i].day) - start_date;
+		day = data.haul_day[i];
 		if(day != day_index)
 			break;
 		
-		index = vessel_index[year_data[i].name];
+		index = data.haul_vessel[i];
+		PROFILE_COUNT("vessel lookups", 1);
 		credits_needed = int(vessel_data[index].cim_A * year_data[i].chinook + 0.5);
 		
-		if(credits_needed > vessel_data[index].credits) // vessel needs credits
+		if(credits_needed > states[index].credits) // vessel needs credits
 		{
 			vessel_need.index = index;
 			vessel_need.amount = credits_needed;
-			vessel_need.bycatch_rate = vessel_data[index].actual_chinook_A / vessel_data[index].actual_pollock_A;
+			vessel_need.bycatch_rate = states[index].actual_chinook_A / states[index].actual_pollock_A;
 			needy_db.push_back(vessel_need);
 		}
 	}
 	sort(needy_db.begin(), needy_db.end());
+	PROFILE_COUNT("needy vessels", needy_db.size());
 	
 	for(int i = 0; i < needy_db.size(); i++)
 	{
 		if(credits_available == 0)
 			break;
-		else if(credits_available > needy_db[i].amount)
+		else if(credits_available > to_credit_units(needy_db[i].amount))
 		{
-			vessel_data[needy_db[i].index].credits += needy_db[i].amount;
-			credits_available -= needy_db[i].amount;
-			credits_transferred += needy_db[i].amount;
-			//cerr << "transferred " << needy_db[i].amount << " to " << vessel_data[needy_db[i].index].name << "\n";
+			set_credits(states[needy_db[i].index], states[needy_db[i].index].credits + needy_db[i].amount);
+			credits_available -= to_credit_units(needy_db[i].amount);
+			credits_transferred += to_credit_units(needy_db[i].amount);
+			PROFILE_COUNT("transfers", 1);
+			//cerr << "transferred " << needy_db[i].amount << " to " << vessel_years[needy_db[i].index].name << "\n";
 		}
 		else
 		{
-			vessel_data[needy_db[i].index].credits += credits_available;
-			//cerr << "transferred " << credits_available << " to " << vessel_data[needy_db[i].index].name << "\n";
+			// only whole credits go to the vessel; the fraction left in the pool is spent too
+			set_credits(states[needy_db[i].index], states[needy_db[i].index].credits + int(credits_available / CREDIT_SCALE));
+			//cerr << "transferred " << credits_available << " to " << vessel_years[needy_db[i].index].name << "\n";
 			credits_transferred += credits_available;
 			credits_available = 0;
+			PROFILE_COUNT("transfers", 1);
 		}
 	}
 	
@@ -956,10 +1267,10 @@ void simulator::transfer_credits(vector<vessel> & vessel_data, const int year, c
 
 void simulator::print_credit_data(vector<vessel> & vessel_data, const int year)
 {
+	PROFILE_SCOPE("print_credit_data");
 	char filename[40];
 	sprintf(filename, "credit_supply_demand.%d.csv", year);
-	ofstream out;
-	out.open(filename);
+	csv_buffer out;
 	
 	int start_b_season = day_count(year, 6, 11) - start_date;
 	
@@ -971,11 +1282,20 @@ void simulator::print_credit_data(vector<vessel> & vessel_data, const int year)
 	out << "Bycatch, Bycatch (std), Bycatch Rate\n";
 	
 	int num_vessels = vessel_data.size();
-	double pollock, pollock_std;
-	int bycatch, bycatch_std;
-	int credits, num_limit_vessels;
+	int num_limit_vessels_A = 0, num_limit_vessels_B = 0;
+	int num_limit_vessels;
 	bool b_flag = false;
 	
+	// vessels that run out on each day, accumulated as the days go by
+	vector<int> out_A(num_days, 0), out_B(num_days, 0);
+	for(int j = 0; j < num_vessels; j++)
+	{
+		if(states[j].out_date_A < num_days)
+			out_A[max(states[j].out_date_A, 0)]++;
+		if(states[j].out_date_B < num_days)
+			out_B[max(states[j].out_date_B, 0)]++;
+	}
+	
 	for(int i = 0; i < num_days; i++)
 	{
 		if(i == start_b_season)
@@ -983,46 +1303,66 @@ void simulator::print_credit_data(vector<vessel> & vessel_data, const int year)
 			out << "\n";
 			b_flag = true;
 		}
-		pollock = 0;
-		bycatch = 0;
-		pollock_std = 0;
-		bycatch_std = 0;
-		credits = 0;
-		num_limit_vessels = 0;
-		for(int j = 0; j < num_vessels; j++)
-		{
-			pollock += vessel_data[j].pollock[i];
-			bycatch += vessel_data[j].chinook[i];
-			pollock_std += vessel_data[j].pollock_std[i];
-			bycatch_std += vessel_data[j].chinook_std[i];
-			if((b_flag && (i >= vessel_data[j].out_date_B)) ||
-			   (!b_flag && (i >= vessel_data[j].out_date_A)))
-				num_limit_vessels ++;
-		}
+		num_limit_vessels_A += out_A[i];
+		num_limit_vessels_B += out_B[i];
+		num_limit_vessels = b_flag ? num_limit_vessels_B : num_limit_vessels_A;
 		
 		//if((pollock > 0) || (i == start_b_season-1))
 		{
 			out << day_name(i + start_date, year) << ",";
 			//out << credits << ",";
 			out << num_limit_vessels << ",";
-			out << pollock << ",";
-			out << pollock_std << ",";
-			out << bycatch << ",";
-			out << bycatch_std << ",";
-			out << bycatch / pollock << "\n";
+			out << day_pollock[i] << ",";
+			out << day_pollock_std[i] << ",";
+			out << day_chinook[i] << ",";
+			out << day_chinook_std[i] << ",";
+			out << day_chinook[i] / day_pollock[i] << "\n";
 		}
 	}
 	
-	out.close();
+	writer.write(output_prefix + filename, out.take());
+	return;
+}
+
+// per-day fleet totals from the replay, when recording is turned on
+void simulator::print_fleet_series(const int year)
+{
+	PROFILE_SCOPE("print_fleet_series");
+	if(!record_fleet_series)
+		return;
+	
+	char filename[40];
+	sprintf(filename, "fleet_series.%d.csv", year);
+	csv_buffer out;
+	
+	out << "Date, Credits (vessels), Vessels (out of credits),";
+	out << "Pollock A (std), Pollock B (std), Bycatch A (std), Bycatch B (std),";
+	out << "Credits (available), Credits (held), Credits (transferred)\n";
+	for(int k = 0; k < fleet_series.size(); k++)
+	{
+		const fleet_state & f = fleet_series[k];
+		out << day_name(f.day + start_date, year) << ",";
+		out << f.credits << ",";
+		out << f.vessels_out << ",";
+		out << f.actual_pollock_A << ",";
+		out << f.actual_pollock_B << ",";
+		out << f.actual_chinook_A << ",";
+		out << f.actual_chinook_B << ",";
+		out << f.credits_available << ",";
+		out << f.credits_held << ",";
+		out << f.credits_transferred << "\n";
+	}
+	
+	writer.write(output_prefix + filename, out.take());
 	return;
 }
 
 void simulator::print_vessel_data(vector<vessel> & vessel_data, const int year)
 {
+	PROFILE_SCOPE("print_vessel_data");
 	char filename[40];
 	sprintf(filename, "vessel_data.%d.csv", year);
-	ofstream out;
-	out.open(filename);
+	csv_buffer out;
 	
 	int start_b_season = day_count(year, 6, 11) - start_date;
 	
@@ -1036,18 +1376,19 @@ void simulator::print_vessel_data(vector<vessel> & vessel_data, const int year)
 	out << "Pollock,Bycatch,Uncaught Pollock,Bycatch Rate,Credit Factor,Credits,z-score,q-value,";
 	out << "Pollock,Bycatch,Uncaught Pollock,Bycatch Rate,Credits\n";
 	
+	const vector<vessel_year> & vessel_years = year_set->vessels;
 	int num_vessels = vessel_data.size();
 	double credits_needed;
 	
 	for(int j = 0; j < num_vessels; j++)
 	{
-		out << vessel_data[j].name << ",";
-		out << vessel_data[j].coop << ",";
+		out << vessel_years[j].name << ",";
+		out << vessel_years[j].coop << ",";
 		
 		// A season data
-		out << vessel_data[j].actual_pollock_A << ",";
-		out << vessel_data[j].actual_chinook_A << ",";
-		if(vessel_data[j].pollock_A > 0)
+		out << states[j].actual_pollock_A << ",";
+		out << states[j].actual_chinook_A << ",";
+		if(vessel_years[j].pollock_A > 0)
 		{
 			out << vessel_data[j].uncaught_pollock_A << ",";
 			out << vessel_data[j].actual_bycatch_rate_A << ",";
@@ -1062,9 +1403,9 @@ void simulator::print_vessel_data(vector<vessel> & vessel_data, const int year)
 		}
 		
 		// B season data
-		out << vessel_data[j].actual_pollock_B << ",";
-		out << vessel_data[j].actual_chinook_B << ",";
-		if(vessel_data[j].pollock_B > 0)
+		out << states[j].actual_pollock_B << ",";
+		out << states[j].actual_chinook_B << ",";
+		if(vessel_years[j].pollock_B > 0)
 		{
 			out << vessel_data[j].uncaught_pollock_B << ",";
 			out << vessel_data[j].actual_bycatch_rate_B << ",";
@@ -1079,8 +1420,8 @@ void simulator::print_vessel_data(vector<vessel> & vessel_data, const int year)
 		}
 		
 		// yearly data
-		out << vessel_data[j].actual_pollock_A + vessel_data[j].actual_pollock_B << ",";
-		out << vessel_data[j].actual_chinook_A + vessel_data[j].actual_chinook_B  << ",";
+		out << states[j].actual_pollock_A + states[j].actual_pollock_B << ",";
+		out << states[j].actual_chinook_A + states[j].actual_chinook_B  << ",";
 		out << vessel_data[j].uncaught_pollock_A + vessel_data[j].uncaught_pollock_B << ",";
 		out << vessel_data[j].bycatch_rate_total << ",";
 		out << vessel_data[j].init_credits_A + vessel_data[j].init_credits_B << "\n";
@@ -1093,14 +1434,14 @@ void simulator::print_vessel_data(vector<vessel> & vessel_data, const int year)
 	for(int j = 0; j < num_vessels; j++)
 	{
 		// A season data
-		pollock_A += vessel_data[j].actual_pollock_A;
-		chinook_A += vessel_data[j].actual_chinook_A;
+		pollock_A += states[j].actual_pollock_A;
+		chinook_A += states[j].actual_chinook_A;
 		uncaught_pollock_A += vessel_data[j].uncaught_pollock_A;
 		init_credits_A += vessel_data[j].init_credits_A;
 		
 		// B season data
-		pollock_B += vessel_data[j].actual_pollock_B;
-		chinook_B += vessel_data[j].actual_chinook_B;
+		pollock_B += states[j].actual_pollock_B;
+		chinook_B += states[j].actual_chinook_B;
 		uncaught_pollock_B += vessel_data[j].uncaught_pollock_B;
 		init_credits_B += vessel_data[j].init_credits_B;
 	}
@@ -1117,21 +1458,145 @@ void simulator::print_vessel_data(vector<vessel> & vessel_data, const int year)
 	out << (chinook_A + chinook_B) / (pollock_A + pollock_B) << ",";
 	out << init_credits_A + init_credits_B << "\n";
 	
-	out.close();
+	writer.write(output_prefix + filename, out.take());
+	return;
+}
+
+// the vessel and daily tables in one columnar file; season
+// values are NaN (credits 0) for vessels that did not fish that season
+void simulator::print_results(vector<vessel> & vessel_data, const int year)
+{
+	PROFILE_SCOPE("print_results");
+	char filename[40];
+	sprintf(filename, "results.%d.col", year);
 	
-	unfished_pollock_A.push_back(uncaught_pollock_A);
-	unfished_pollock_B.push_back(uncaught_pollock_B);
-	years.push_back(year);
+	const vector<vessel_year> & vessel_years = year_set->vessels;
+	int num_vessels = vessel_data.size();
+	const double missing = nan("");
+	vector<string> names(num_vessels), coops(num_vessels);
+	vector<double> pollock(num_vessels), uncaught_pollock(num_vessels), bycatch_rate(num_vessels);
+	vector<double> credit_factor(num_vessels), z(num_vessels), q(num_vessels);
+	vector<int> chinook(num_vessels), credits(num_vessels);
+	
+	results.clear(year);
+	results.begin_table("vessels", num_vessels);
+	for(int j = 0; j < num_vessels; j++)
+	{
+		names[j] = vessel_years[j].name;
+		coops[j] = vessel_years[j].coop;
+	}
+	results.add_column("name", names);
+	results.add_column("coop", coops);
+	for(int s = 0; s < 2; s++)
+	{
+		for(int j = 0; j < num_vessels; j++)
+		{
+			const vessel & v = vessel_data[j];
+			const vessel_state & state = states[j];
+			bool fished = (s == 0 ? vessel_years[j].pollock_A : vessel_years[j].pollock_B) > 0;
+			pollock[j] = s == 0 ? state.actual_pollock_A : state.actual_pollock_B;
+			chinook[j] = s == 0 ? state.actual_chinook_A : state.actual_chinook_B;
+			uncaught_pollock[j] = !fished ? missing : (s == 0 ? v.uncaught_pollock_A : v.uncaught_pollock_B);
+			bycatch_rate[j] = !fished ? missing : (s == 0 ? v.actual_bycatch_rate_A : v.actual_bycatch_rate_B);
+			credit_factor[j] = !fished ? missing : (s == 0 ? v.credit_factor_A : v.credit_factor_B);
+			credits[j] = !fished ? 0 : (s == 0 ? v.init_credits_A : v.init_credits_B);
+			z[j] = !fished ? missing : (s == 0 ? v.z_A : v.z_B);
+			q[j] = !fished ? missing : (s == 0 ? v.q_A : v.q_B);
+		}
+		string season = (s == 0) ? "_A" : "_B";
+		results.add_column("pollock" + season, pollock.data());
+		results.add_column("chinook" + season, chinook.data());
+		results.add_column("uncaught_pollock" + season, uncaught_pollock.data());
+		results.add_column("bycatch_rate" + season, bycatch_rate.data());
+		results.add_column("credit_factor" + season, credit_factor.data());
+		results.add_column("credits" + season, credits.data());
+		results.add_column("z" + season, z.data());
+		results.add_column("q" + season, q.data());
+	}
+	
+	// daily fleet totals, as in credit_supply_demand
+	vector<string> dates(num_days);
+	vector<double> rate(num_days);
+	for(int i = 0; i < num_days; i++)
+	{
+		dates[i] = day_name(i + start_date, year);
+		rate[i] = day_chinook[i] / day_pollock[i];
+	}
+	results.begin_table("days", num_days);
+	results.add_column("date", dates);
+	results.add_column("pollock", day_pollock.data());
+	results.add_column("pollock_std", day_pollock_std.data());
+	results.add_column("bycatch", day_chinook.data());
+	results.add_column("bycatch_std", day_chinook_std.data());
+	results.add_column("bycatch_rate", rate.data());
+	
+	writer.write(output_prefix + filename, results.build());
+	return;
+}
+
+// the year's parameters, summary and vessel rows for the current scenarios;
+// season values are NULL for vessels that did not fish that season
+void simulator::print_database(vector<vessel> & vessel_data, const int year)
+{
+	PROFILE_SCOPE("print_database");
+	if(database == NULL)
+		return;
 	
+	results_row row;
+	const double missing = nan("");
+	const vector<vessel_year> & vessel_years = year_set->vessels;
+	int num_vessels = vessel_data.size();
+	for(int s = 0; s < scenario_ids.size(); s++)
+	{
+		row.scenario = scenario_ids[s];
+		row.year = year;
+		
+		row.table = PARAMETERS_TABLE;
+		double parameters[13] = {HARD_CAP, TARGET_CAP, ALPHA, BETA, GAMMA, double(penalty_func), 
+			double(trading_rule), DELTA, EPSILON, PURCHASE_LIMIT, DYNAMIC_STRANDING_LIMIT, TAX_RATE, PSI};
+		copy(parameters, parameters + 13, row.values);
+		database->add_row(row);
+		
+		row.table = SUMMARIES_TABLE;
+		row.values[0] = current_summary.target_level;
+		row.values[1] = current_summary.credits_distributed;
+		row.values[2] = current_summary.credits_used;
+		row.values[3] = current_summary.credits_transferred;
+		row.values[4] = current_summary.credits_held;
+		row.values[5] = current_summary.original_bycatch;
+		database->add_row(row);
+		
+		row.table = VESSELS_TABLE;
+		for(int j = 0; j < num_vessels; j++)
+		{
+			const vessel & v = vessel_data[j];
+			const vessel_state & state = states[j];
+			bool fished_A = vessel_years[j].pollock_A > 0;
+			bool fished_B = vessel_years[j].pollock_B > 0;
+			row.name = vessel_years[j].name;
+			row.coop = vessel_years[j].coop;
+			double values[16] = {
+				state.actual_pollock_A, double(state.actual_chinook_A), 
+				fished_A ? v.uncaught_pollock_A : missing, fished_A ? v.actual_bycatch_rate_A : missing, 
+				fished_A ? v.credit_factor_A : missing, fished_A ? double(v.init_credits_A) : missing, 
+				fished_A ? v.z_A : missing, fished_A ? v.q_A : missing, 
+				state.actual_pollock_B, double(state.actual_chinook_B), 
+				fished_B ? v.uncaught_pollock_B : missing, fished_B ? v.actual_bycatch_rate_B : missing, 
+				fished_B ? v.credit_factor_B : missing, fished_B ? double(v.init_credits_B) : missing, 
+				fished_B ? v.z_B : missing, fished_B ? v.q_B : missing};
+			copy(values, values + 16, row.values);
+			database->add_row(row);
+		}
+	}
 	return;
 }
 
 void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year)
 {
+	PROFILE_SCOPE("print_credit_deltas");
 	char filename[40];
 	sprintf(filename, "credit_delta_calc.%d.csv", year);
-	ofstream out;
-	out.open(filename);
+	csv_buffer out;
 	
 	int start_b_season = day_count(year, 6, 11) - start_date;
 	int DELTA_BYCATCH = 10;
@@ -1150,6 +1615,7 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 	out << "Bycatch (adj),Bycatch Rate (adj),z-score (adj),q-value (adj),Credit Factor (adj),Credits (adj),Delta";
 	out << "\n";
 	
+	const vector<vessel_year> & vessel_years = year_set->vessels;
 	int num_vessels = vessel_data.size();
 	double credits_needed;
 	double new_credit_factor;
@@ -1173,20 +1639,20 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 	for(int j = 0; j < num_vessels; j++)
 	{
 		// A season data
-		pollock_A += vessel_data[j].actual_pollock_A;
-		chinook_A += vessel_data[j].actual_chinook_A;
+		pollock_A += states[j].actual_pollock_A;
+		chinook_A += states[j].actual_chinook_A;
 		init_credits_A += vessel_data[j].init_credits_A;
-		if(vessel_data[j].pollock_A > 0)
+		if(vessel_years[j].pollock_A > 0)
 		{
 			sum_A += vessel_data[j].actual_bycatch_rate_A;
 			count_A ++;
 		}
 		
 		// B season data
-		pollock_B += vessel_data[j].actual_pollock_B;
-		chinook_B += vessel_data[j].actual_chinook_B;
+		pollock_B += states[j].actual_pollock_B;
+		chinook_B += states[j].actual_chinook_B;
 		init_credits_B += vessel_data[j].init_credits_B;
-		if(vessel_data[j].pollock_B > 0)
+		if(vessel_years[j].pollock_B > 0)
 		{
 			sum_B += vessel_data[j].actual_bycatch_rate_B;
 			count_B ++;
@@ -1205,13 +1671,13 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 	
 	for(int j = 0; j < num_vessels; j++)
 	{
-		out << vessel_data[j].name << ",";
-		out << vessel_data[j].coop << ",";
+		out << vessel_years[j].name << ",";
+		out << vessel_years[j].coop << ",";
 		
 		// A season data
-		out << vessel_data[j].actual_pollock_A << ",";
-		out << vessel_data[j].actual_chinook_A << ",";
-		if(vessel_data[j].pollock_A > 0)
+		out << states[j].actual_pollock_A << ",";
+		out << states[j].actual_chinook_A << ",";
+		if(vessel_years[j].pollock_A > 0)
 		{
 			out << vessel_data[j].actual_bycatch_rate_A << ",";
 			out << vessel_data[j].z_A << ",";
@@ -1219,34 +1685,20 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 			out << vessel_data[j].credit_factor_A << ",";
 			new_credit_factor = ALPHA + BETA * vessel_data[j].credit_factor_A + GAMMA * vessel_data[j].q_A;
 			out << new_credit_factor << ",";
-			out << vessel_data[j].pollock_A / season_pollock_A << ",";
+			out << vessel_years[j].pollock_A / season_pollock_A << ",";
 			out << vessel_data[j].init_credits_A << ",";
-			out << int(vessel_data[j].pollock_A / season_pollock_A * new_credit_factor * credits_A) << ",";
+			out << int(vessel_years[j].pollock_A / season_pollock_A * new_credit_factor * credits_A) << ",";
 			
-			bycatch_adj = vessel_data[j].actual_chinook_A + DELTA_BYCATCH;
+			bycatch_adj = states[j].actual_chinook_A + DELTA_BYCATCH;
 			if(bycatch_adj < 0)
 				bycatch_adj = 0;
-			bycatch_rate_adj = double(bycatch_adj) / vessel_data[j].actual_pollock_A;
+			bycatch_rate_adj = double(bycatch_adj) / states[j].actual_pollock_A;
 			//mean_adj = (sum_A - vessel_data[j].actual_bycatch_rate_A + bycatch_rate_adj) / count_A;
 			mean_adj = mean_A;
-			stdev_adj = stdev_A * sqrt(1 + 1.0 / count_A) / sqrt(1 + vessel_data[j].pollock_A / season_pollock_A);
+			stdev_adj = stdev_A * sqrt(1 + 1.0 / count_A) / sqrt(1 + vessel_years[j].pollock_A / season_pollock_A);
 			z_adj = (mean_adj - bycatch_rate_adj) / stdev_adj;
 			
-			switch(penalty_func)
-			{
-				case SHALLOW:
-					p_adj = shallow_slope(z_adj);
-					break;
-				case NORMAL:
-					p_adj = normal_pvalue(z_adj, z_table);
-					break;
-				case MODERATE:
-					p_adj = moderate_slope(z_adj);
-					break;
-				case LINEAR:
-					p_adj = linear(z_adj);
-					break;
-			}
+			evaluate_penalty(&z_adj, &p_adj, 1);
 			q_adj = EPSILON * p_adj + DELTA;
 			credit_factor_adj = ALPHA + BETA * vessel_data[j].credit_factor_A + GAMMA * q_adj;
 			
@@ -1255,10 +1707,10 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 			out << z_adj << ",";
 			out << q_adj << ",";
 			out << credit_factor_adj << ",";
-			out << int(vessel_data[j].pollock_A / season_pollock_A * credit_factor_adj * credits_A) << ",";
-			out << int(vessel_data[j].pollock_A / season_pollock_A * credit_factor_adj * credits_A) - int(vessel_data[j].pollock_A / season_pollock_A * new_credit_factor * credits_A) << ",";
+			out << int(vessel_years[j].pollock_A / season_pollock_A * credit_factor_adj * credits_A) << ",";
+			out << int(vessel_years[j].pollock_A / season_pollock_A * credit_factor_adj * credits_A) - int(vessel_years[j].pollock_A / season_pollock_A * new_credit_factor * credits_A) << ",";
 			if(vessel_data[j].chinook_A > -DELTA_BYCATCH)
-				deltas.push_back(int(vessel_data[j].pollock_A / season_pollock_A * credit_factor_adj * credits_A) - int(vessel_data[j].pollock_A / season_pollock_A * new_credit_factor * credits_A));
+				deltas.push_back(int(vessel_years[j].pollock_A / season_pollock_A * credit_factor_adj * credits_A) - int(vessel_years[j].pollock_A / season_pollock_A * new_credit_factor * credits_A));
 			
 		}
 		else
@@ -1268,9 +1720,9 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 		
 		
 		// B season data
-		out << vessel_data[j].actual_pollock_B << ",";
-		out << vessel_data[j].actual_chinook_B << ",";
-		if(vessel_data[j].pollock_B > 0)
+		out << states[j].actual_pollock_B << ",";
+		out << states[j].actual_chinook_B << ",";
+		if(vessel_years[j].pollock_B > 0)
 		{
 			out << vessel_data[j].actual_bycatch_rate_B << ",";
 			out << vessel_data[j].z_B << ",";
@@ -1278,33 +1730,19 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 			out << vessel_data[j].credit_factor_B << ",";
 			new_credit_factor = ALPHA + BETA * vessel_data[j].credit_factor_B + GAMMA * vessel_data[j].q_B;
 			out << new_credit_factor << ",";
-			out << vessel_data[j].pollock_B / season_pollock_B << ",";
+			out << vessel_years[j].pollock_B / season_pollock_B << ",";
 			out << vessel_data[j].init_credits_B << ",";
-			out << int(vessel_data[j].pollock_B / season_pollock_B * new_credit_factor * credits_B) << ",";
+			out << int(vessel_years[j].pollock_B / season_pollock_B * new_credit_factor * credits_B) << ",";
 			
-			bycatch_adj = vessel_data[j].actual_chinook_B + DELTA_BYCATCH;
+			bycatch_adj = states[j].actual_chinook_B + DELTA_BYCATCH;
 			if(bycatch_adj < 0)
 				bycatch_adj = 0;
-			bycatch_rate_adj = double(bycatch_adj) / vessel_data[j].actual_pollock_B;
+			bycatch_rate_adj = double(bycatch_adj) / states[j].actual_pollock_B;
 			//mean_adj = (sum_B - vessel_data[j].actual_bycatch_rate_B + bycatch_rate_adj) / count_B;
 			mean_adj = mean_B;
-			stdev_adj = stdev_B * sqrt(1 + 1.0 / count_B) / sqrt(1 + vessel_data[j].pollock_B / season_pollock_B);
+			stdev_adj = stdev_B * sqrt(1 + 1.0 / count_B) / sqrt(1 + vessel_years[j].pollock_B / season_pollock_B);
 			z_adj = (mean_adj - bycatch_rate_adj) / stdev_adj;
-			switch(penalty_func)
-			{
-				case SHALLOW:
-					p_adj = shallow_slope(z_adj);
-					break;
-				case NORMAL:
-					p_adj = normal_pvalue(z_adj, z_table);
-					break;
-				case MODERATE:
-					p_adj = moderate_slope(z_adj);
-					break;
-				case LINEAR:
-					p_adj = linear(z_adj);
-					break;
-			}
+			evaluate_penalty(&z_adj, &p_adj, 1);
 			q_adj = EPSILON * p_adj + DELTA;
 			credit_factor_adj = ALPHA + BETA * vessel_data[j].credit_factor_B + GAMMA * q_adj;
 			
@@ -1313,10 +1751,10 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 			out << z_adj << ",";
 			out << q_adj << ",";
 			out << credit_factor_adj << ",";
-			out << int(vessel_data[j].pollock_B / season_pollock_B * credit_factor_adj * credits_B) << ",";
-			out << int(vessel_data[j].pollock_B / season_pollock_B * credit_factor_adj * credits_B) - int(vessel_data[j].pollock_B / season_pollock_B * new_credit_factor * credits_B);
-			if(vessel_data[j].actual_chinook_B > -DELTA_BYCATCH)
-				deltas.push_back(int(vessel_data[j].pollock_B / season_pollock_B * credit_factor_adj * credits_B) - int(vessel_data[j].pollock_B / season_pollock_B * new_credit_factor * credits_B));
+			out << int(vessel_years[j].pollock_B / season_pollock_B * credit_factor_adj * credits_B) << ",";
+			out << int(vessel_years[j].pollock_B / season_pollock_B * credit_factor_adj * credits_B) - int(vessel_years[j].pollock_B / season_pollock_B * new_credit_factor * credits_B);
+			if(states[j].actual_chinook_B > -DELTA_BYCATCH)
+				deltas.push_back(int(vessel_years[j].pollock_B / season_pollock_B * credit_factor_adj * credits_B) - int(vessel_years[j].pollock_B / season_pollock_B * new_credit_factor * credits_B));
 			
 		}
 		else
@@ -1338,24 +1776,66 @@ void simulator::print_credit_deltas(vector<vessel> & vessel_data, const int year
 	out << init_credits_B << ",,,,,,";
 	out << "\n";
 	
-	out.close();
+	writer.write(output_prefix + filename, out.take());
 	
 	sprintf(filename, "credit_deltas.%d.csv", year);
-	out.open(filename);
 	for(int i = 0; i < deltas.size(); i++)
 	{
 		out << deltas[i] << "\n";
 	}
-	out.close();
+	writer.write(output_prefix + filename, out.take());
+	return;
+}
+
+// run-level files for the selected sinks
+void simulator::print_run_data()
+{
+	if(output_sinks & CSV_SINK)
+	{
+		print_unfished_data();
+		print_floor_prices();
+	}
+	if(output_sinks & SUMMARY_SINK)
+		print_summary();
+	return;
+}
+
+void simulator::print_summary()
+{
+	PROFILE_SCOPE("print_summary");
+	char filename[40];
+	sprintf(filename, "summary_output.txt");
+	csv_buffer out;
+	
+	// header row
+	out << "year" << "\t";
+	out << "target level" << "\t";
+	out << "credits distributed" << "\t";
+	out << "credits used" << "\t";
+	out << "credits transferred" << "\t";
+	out << "credits held" << "\t";
+	out << "total bycatch (original)" << "\n";
+	
+	for(int i = 0; i < summaries.size(); i++)
+	{
+		out << summaries[i].year << "\t";
+		out << summaries[i].target_level << "\t";
+		out << summaries[i].credits_distributed << "\t";
+		out << summaries[i].credits_used << "\t";
+		out << summaries[i].credits_transferred << "\t";
+		out << summaries[i].credits_held << "\t";
+		out << summaries[i].original_bycatch << "\n";
+	}
+	writer.write(output_prefix + filename, out.take());
 	return;
 }
 
 void simulator::print_unfished_data()
 {
+	PROFILE_SCOPE("print_unfished_data");
 	char filename[40];
 	sprintf(filename, "unfished_pollock.csv");
-	ofstream out;
-	out.open(filename);
+	csv_buffer out;
 	
 	// header row
 	out << "year,";
@@ -1371,15 +1851,345 @@ void simulator::print_unfished_data()
 		out << unfished_pollock_B[i];
 		out << "\n";
 	}
-	out.close();
+	writer.write(output_prefix + filename, out.take());
 	return;
 }
 
-void simulator::save_vessel_data(vector<vessel> & vessel_data)
+void simulator::print_floor_prices()
 {
+	PROFILE_SCOPE("print_floor_prices");
+	char filename[40];
+	sprintf(filename, "floor_prices.csv");
+	csv_buffer out;
+	
+	// header rows
+	out << ",A season,,,,,,B season\n";
+	for(int s = 0; s < 2; s++)
+	{
+		out << (s == 0 ? "year," : ",,");
+		out << "date,sector rate,sector implied value,worst vessel rate,worst vessel implied value";
+	}
+	out << "\n";
+	
+	// implied value of a credit is the pollock it covers at the rate
+	int num_years = years.size();
+	for(int i = 0; i < num_years; i++)
+	{
+		out << years[i];
+		for(int s = 0; s < 2; s++)
+		{
+			const floor_price & f = (s == 0) ? floor_prices_A[i] : floor_prices_B[i];
+			double value_per_tonne = LBS_PER_TONNE * (s == 0 ? CREDIT_VALUE_A : CREDIT_VALUE_B);
+			out << (s == 0 ? "," : ",,");
+			if(f.date < 0)
+			{
+				out << "NA,NA,NA,NA,NA";
+				continue;
+			}
+			out << day_name(f.date, years[i]) << ",";
+			out << f.sector_rate << ",";
+			out << value_per_tonne / f.sector_rate << ",";
+			out << f.worst_rate << ",";
+			out << value_per_tonne / f.worst_rate;
+		}
+		out << "\n";
+	}
+	writer.write(output_prefix + filename, out.take());
+	return;
+}
+
+void simulator::save_vessel_data(const int year)
+{
+	PROFILE_SCOPE("save_vessel_data");
+	char filename[40];
+	sprintf(filename, "credit_factors.%d.dat", year);
+	if(!save_factor_store(output_prefix + filename, year, *credit_factor_DB, vessel_keys))
+		cerr << "could not save " << output_prefix + filename << ".\n";
+	return;
+}
+
+bool simulator::warm_start(const int year)
+{
+	PROFILE_SCOPE("warm_start");
+	char filename[40];
+	sprintf(filename, "credit_factors.%d.dat", year - 1);
+	factor_store_view store;
+	if(!store.open(output_prefix + filename))
+		return false;
+	
+	// the factors must be those a run from 2000 with the current parameters
+	// would have reached, not another policy's
+	unsigned long long expected = 0;
+	for(int y = 2000; y < year; y++)
+		expected = params_fingerprint(expected);
+	if(store.year() != year - 1 || store.fingerprint() != expected)
+	{
+		cerr << output_prefix + filename << " was saved under other policy parameters.\n";
+		return false;
+	}
+	
+	credit_factor_ptr stored(new credit_factor_db);
+	stored->reserve(vessel_ids.size());
+	
+	// ids are assigned when the landings are read, so match vessels by key;
+	// vessels missing from these landings get ids of their own, so their
+	// factors are carried into the next store instead of being lost
+	int num_slots = store.size();
+	int id;
+	for(int i = 0; i < num_slots; i++)
+	{
+		if(!store.present[i])
+			continue;
+		id = intern_key(store.key(i));
+		stored->add(id);
+		stored->p_A[id] = store.p_A[i];
+		stored->p_B[id] = store.p_B[i];
+		stored->q_A[id] = store.q_A[i];
+		stored->q_B[id] = store.q_B[i];
+		stored->cim_A[id] = store.cim_A[i];
+		stored->cim_B[id] = store.cim_B[i];
+	}
+	stored->fingerprint = expected;
+	credit_factor_DB = stored;
+	return true;
+}
+
+// mixes the policy parameters, and the name of the penalty curve, into the
+// fingerprint of the years before (FNV-1a over their bytes)
+unsigned long long simulator::params_fingerprint(const unsigned long long previous) const
+{
+	double values[12] = {HARD_CAP, TARGET_CAP, ALPHA, BETA, GAMMA, double(trading_rule), 
+		DELTA, EPSILON, PURCHASE_LIMIT, DYNAMIC_STRANDING_LIMIT, TAX_RATE, PSI};
+	const string & curve = penalty_curves[penalty_func].name;
+	const unsigned char * bytes = (const unsigned char *)values;
+	unsigned long long hash = previous ^ 14695981039346656037ULL;
+	for(size_t i = 0; i < sizeof(values); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	for(size_t i = 0; i < curve.length(); i++)
+	{
+		hash ^= (unsigned char)curve[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+policy_params simulator::get_params() const
+{
+	policy_params params;
+	params.HARD_CAP = HARD_CAP;
+	params.TARGET_CAP = TARGET_CAP;
+	params.ALPHA = ALPHA;
+	params.BETA = BETA;
+	params.GAMMA = GAMMA;
+	params.penalty_func = penalty_func;
+	params.trading_rule = trading_rule;
+	params.DELTA = DELTA;
+	params.EPSILON = EPSILON;
+	params.PURCHASE_LIMIT = PURCHASE_LIMIT;
+	params.DYNAMIC_STRANDING_LIMIT = DYNAMIC_STRANDING_LIMIT;
+	params.TAX_RATE = TAX_RATE;
+	params.PSI = PSI;
+	return params;
+}
+
+void simulator::set_params(const policy_params & params)
+{
+	HARD_CAP = params.HARD_CAP;
+	TARGET_CAP = params.TARGET_CAP;
+	ALPHA = params.ALPHA;
+	BETA = params.BETA;
+	GAMMA = params.GAMMA;
+	penalty_func = params.penalty_func;
+	trading_rule = params.trading_rule;
+	DELTA = params.DELTA;
+	EPSILON = params.EPSILON;
+	PURCHASE_LIMIT = params.PURCHASE_LIMIT;
+	DYNAMIC_STRANDING_LIMIT = params.DYNAMIC_STRANDING_LIMIT;
+	TAX_RATE = params.TAX_RATE;
+	PSI = params.PSI;
+	return;
+}
+
+credit_factor_ptr simulator::get_credit_factors() const
+{
+	return credit_factor_DB;
+}
+
+void simulator::set_credit_factors(const credit_factor_ptr & credit_factors)
+{
+	credit_factor_DB = credit_factors;
+	return;
+}
+
+credit_factor_db & simulator::mutable_credit_factors()
+{
+	// another scenario branch still refers to this state, so take a private copy
+	if(credit_factor_DB.use_count() > 1)
+		credit_factor_DB.reset(new credit_factor_db(*credit_factor_DB));
+	return *credit_factor_DB;
+}
+
+int simulator::intern_vessel(const string & name, const string & coop)
+{
+	// vessels are identified by name and coop together
+	return intern_key(name + "," + coop);
+}
+
+int simulator::intern_key(const string & key)
+{
+	pair<unordered_map<string, int>::iterator, bool> entry = 
+	vessel_ids.insert(make_pair(key, int(vessel_ids.size())));
+	if(entry.second)
+		vessel_keys.push_back(entry.first->first);
+	return entry.first->second;
+}
+
+// keep the first num_years of the per-run totals
+void simulator::rewind_run_data(const int num_years)
+{
+	unfished_pollock_A.resize(num_years);
+	unfished_pollock_B.resize(num_years);
+	years.resize(num_years);
+	floor_prices_A.resize(num_years);
+	floor_prices_B.resize(num_years);
+	summaries.resize(num_years);
 	return;
 }
 
+// add a year to the per-run totals
+void simulator::record_year(const vector<vessel> & vessel_data, const int year)
+{
+	int num_vessels = vessel_data.size();
+	double uncaught_pollock_A = 0, uncaught_pollock_B = 0;
+	for(int j = 0; (output_needs & UNFISHED_TOTALS) && j < num_vessels; j++)
+	{
+		uncaught_pollock_A += vessel_data[j].uncaught_pollock_A;
+		uncaught_pollock_B += vessel_data[j].uncaught_pollock_B;
+	}
+	unfished_pollock_A.push_back(uncaught_pollock_A);
+	unfished_pollock_B.push_back(uncaught_pollock_B);
+	years.push_back(year);
+	floor_prices_A.push_back(year_set->floor_A);
+	floor_prices_B.push_back(year_set->floor_B);
+	if(output_needs & YEAR_SUMMARY)
+		summaries.push_back(current_summary);
+	return;
+}
+
+void simulator::set_output_prefix(const string & prefix)
+{
+	output_prefix = prefix;
+	return;
+}
+
+const string & simulator::get_output_prefix() const
+{
+	return output_prefix;
+}
+
+// block until all queued output files are written
+void simulator::flush_output()
+{
+	writer.flush();
+	return;
+}
+
+// send DATABASE_SINK rows to database under a new scenario; returns its id
+int simulator::set_results_db(results_db * database, const string & label)
+{
+	int scenario = (database != NULL) ? database->add_scenario(label) : 0;
+	set_results_scenarios(database, vector<int>(1, scenario));
+	return scenario;
+}
+
+// send DATABASE_SINK rows to database under each of these scenarios, e.g. the
+// scenarios of a scenario tree that share the years that follow
+void simulator::set_results_scenarios(results_db * database, const vector<int> & scenarios)
+{
+	this->database = database;
+	scenario_ids = scenarios;
+	return;
+}
+
+void simulator::set_output_sinks(const int sinks)
+{
+	output_sinks = sinks;
+	output_needs = sink_needs(sinks);
+	return;
+}
+
+int sink_needs(const int sinks)
+{
+	int needs = 0;
+	if(sinks & CSV_SINK)
+		needs |= DAILY_TOTALS | VESSEL_TABLE | UNFISHED_TOTALS;
+	if(sinks & COLUMNAR_SINK)
+		needs |= DAILY_TOTALS | VESSEL_TABLE;
+	if(sinks & SUMMARY_SINK)
+		needs |= YEAR_SUMMARY;
+	if(sinks & DATABASE_SINK)
+		needs |= VESSEL_TABLE | YEAR_SUMMARY;
+	return needs;
+}
+
+// the sinks named in a comma-separated list of csv, columnar, summary, store
+// and none (the database sink comes with a database); -1 for an unknown name
+int parse_sinks(const string & names)
+{
+	int sinks = 0;
+	int position = 0;
+	while(position <= names.length())
+	{
+		int end = names.find(',', position);
+		if(end == string::npos)
+			end = names.length();
+		string name = names.substr(position, end - position);
+		if(name == "csv")
+			sinks |= CSV_SINK;
+		else if(name == "columnar")
+			sinks |= COLUMNAR_SINK;
+		else if(name == "summary")
+			sinks |= SUMMARY_SINK;
+		else if(name == "store")
+			sinks |= STORE_SINK;
+		else if(name != "none")
+			return -1;
+		position = end + 1;
+	}
+	return sinks;
+}
+
+void simulator::set_fleet_series(const bool enabled)
+{
+	record_fleet_series = enabled;
+	return;
+}
+
+bool simulator::set_factor_log(const string & filename)
+{
+	// an empty name turns the log off
+	if(filename.length() == 0)
+	{
+		factor_history.close();
+		return true;
+	}
+	return factor_history.open(filename);
+}
+
+bool operator ==(const policy_params & a, const policy_params & b)
+{
+	return a.HARD_CAP == b.HARD_CAP && a.TARGET_CAP == b.TARGET_CAP && 
+	a.ALPHA == b.ALPHA && a.BETA == b.BETA && a.GAMMA == b.GAMMA && 
+	a.penalty_func == b.penalty_func && a.trading_rule == b.trading_rule && 
+	a.DELTA == b.DELTA && a.EPSILON == b.EPSILON && 
+	a.PURCHASE_LIMIT == b.PURCHASE_LIMIT && 
+	a.DYNAMIC_STRANDING_LIMIT == b.DYNAMIC_STRANDING_LIMIT && 
+	a.TAX_RATE == b.TAX_RATE && a.PSI == b.PSI;
+}
+
 bool operator <(const needy_struct & a, const needy_struct & b)
 {
 	return a.bycatch_rate < b.bycatch_rate;
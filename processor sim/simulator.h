@@ -15,8 +15,20 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
 #include "vessel.h"
 #include "simulator_tools.h"
+#include "credit_factor_db.h"
+#include "factor_log.h"
+#include "factor_store.h"
+#include "penalty_curves.h"
+#include "output_writer.h"
+#include "csv_buffer.h"
+#include "column_file.h"
+#include "results_db.h"
+#include "instrument.h"
 
 using namespace std;
 
@@ -28,20 +40,13 @@ struct landing
 	string ticketNumber;
 	string name;
 	string coop;
+	int vessel_id;
 	double pollock;
 	double chinook;
 };
 
-struct credit_factor
-{
-	vector<double> p_A;
-	vector<double> p_B;
-	vector<double> q_A;
-	vector<double> q_B;
-	string name;
-	string coop;
-	double cim_A, cim_B;
-};
+// shared between scenario branches; copied on the first write after a fork
+typedef shared_ptr<credit_factor_db> credit_factor_ptr;
 
 struct needy_struct
 {
@@ -50,6 +55,7 @@ struct needy_struct
 	double bycatch_rate;
 };
 
+// indices of the built-in curves in the penalty registry
 enum PenaltyType
 {
 	NORMAL,
@@ -64,6 +70,138 @@ enum SavingType
 	FIXED_TRANSFER_TAX
 };
 
+// where the results of a run go; any combination of sinks can be selected
+enum OutputSink
+{
+	CSV_SINK = 1,		// credit_supply_demand and vessel_data each year, unfished_pollock and floor_prices per run
+	COLUMNAR_SINK = 2,	// results.<year>.col each year
+	SUMMARY_SINK = 4,	// summary_output.txt per run
+	STORE_SINK = 8,		// credit_factors.<year>.dat each year, for warm starts
+	DATABASE_SINK = 16	// rows in the results database given to set_results_db
+};
+
+// quantities a sink reads, so the ones no sink needs can be skipped
+enum OutputQuantity
+{
+	DAILY_TOTALS = 1,	// fleet totals of the landings data for each day
+	VESSEL_TABLE = 2,	// per-vessel uncaught pollock (bycatch rates feed the factor update, so are always kept)
+	UNFISHED_TOTALS = 4,	// fleet uncaught pollock for each year
+	YEAR_SUMMARY = 8	// a year_summary row for each year
+};
+
+int sink_needs(const int sinks);
+int parse_sinks(const string & names);
+
+// one row of summary_output.txt
+struct year_summary
+{
+	int year;
+	double target_level;
+	double credits_distributed;
+	double credits_used;
+	double credits_transferred;
+	double credits_held;
+	int original_bycatch;
+};
+
+// points in the season replay where the run state is snapshotted; everything
+// before an event is independent of the parameters that event depends on
+enum CheckpointEvent
+{
+	YEAR_START,			// after initialization, before the first haul
+	FIRST_COMPLETION,	// first vessel done, before its credits are pooled (TAX_RATE)
+	SSR_DATE,			// first haul on SSR_set_date, before the SSR is set (DYNAMIC_STRANDING_LIMIT)
+	NUM_CHECKPOINTS
+};
+
+// policy settings that may change from one year to the next
+struct policy_params
+{
+	double HARD_CAP;
+	double TARGET_CAP;
+	
+	double ALPHA;
+	double BETA;
+	double GAMMA;
+	
+	int penalty_func;
+	SavingType trading_rule;
+	double DELTA;
+	double EPSILON;
+	
+	double PURCHASE_LIMIT;
+	double DYNAMIC_STRANDING_LIMIT;
+	double TAX_RATE;
+	
+	double PSI;
+};
+
+bool operator ==(const policy_params & a, const policy_params & b);
+
+// credit factor update inputs and outputs for the fleet, packed structure-of-
+// arrays with the A season vessels followed by the B season vessels
+struct factor_batch
+{
+	int num_A;
+	vector<int> vessel;		// index into vessel_data
+	vector<int> id;
+	vector<double> rate, pollock;
+	vector<double> z, p, q, cim;
+};
+
+// fleet-wide totals kept up to date as the season is replayed
+struct fleet_state
+{
+	int day;
+	int credits;			// held by vessels
+	int vessels_out;		// vessels with no credits left
+	double actual_pollock_A, actual_pollock_B;
+	int actual_chinook_A, actual_chinook_B;
+	double credits_available, credits_held, credits_transferred;	// pools, copied in by record_fleet_day
+};
+
+// bycatch rates in a season when its cumulative chinook first reaches
+// FLOOR_PRICE_CHINOOK; a credit is worth at least what the pollock it lets a
+// vessel fish at these rates is worth
+struct floor_price
+{
+	int date;			// day_count of the haul that reached it, -1 if the season never did
+	double sector_rate;	// chinook per t of pollock for the whole sector to that haul
+	double worst_rate;	// highest rate of any vessel that had fished by then
+};
+
+// a year of landings arranged for replay; it depends only on the landings and
+// FLOOR_PRICE_CHINOOK, which is fixed for the simulator's lifetime, so it is
+// built once and shared by every scenario and thread replaying it
+struct year_dataset
+{
+	int year;
+	int start_date;				// day_count of the first landing
+	int num_days;
+	vector<landing> hauls;
+	vector<int> haul_day;		// day index of each haul
+	vector<int> haul_vessel;	// index into vessels of each haul
+	vector<vessel_year> vessels;
+	floor_price floor_A, floor_B;
+};
+
+typedef shared_ptr<const year_dataset> year_dataset_ptr;
+
+struct sim_checkpoint
+{
+	bool valid;
+	char season;		// 'A' or 'B'
+	int data_index;		// next haul to replay
+	int prev_day;
+	int pending_vessel;	// vessel whose unused credits still need pooling, or -1
+	vector<vessel_state> states;
+	credit_units credits_available, credits_held, credits_transferred;
+	double stranding_rate;
+	bool SSR_set;
+	fleet_state fleet;
+	int num_fleet_days;
+};
+
 class simulator
 	{
 	public:
@@ -72,44 +210,116 @@ class simulator
 		~simulator();
 		
 		void read_in_landings(istream & in);
-		void load_z_table();
-		void process();
+		const vector<landing> & get_landings() const;
+		void set_landings(const vector<landing> & landings);
+		void process(int first_year = 2000);
 		void process_year(const int year);
-		void convert_data(const vector<landing> & raw_data, const int year, 
-						  vector<landing> & year_data, vector<vessel> & vessel_data);
+		void convert_data(const vector<landing> & raw_data, const int year, year_dataset & data);
+		year_dataset_ptr load_year(const int year);
+		void begin_year(const year_dataset_ptr & data, vector<vessel> & vessel_data);
+		vector<vessel_state> & get_vessel_states();
+		fleet_state get_fleet_state() const;
 		void load_credit_factors(vector<vessel> & vessel_data);
 		void process_data(vector<vessel> & vessel_data, const int year);
-		void simulate_year(vector<vessel> & vessel_data, const int year, 
-						   const vector<landing> & year_data);
+		void simulate_year(vector<vessel> & vessel_data, const int year);
 		void simulate_A_season(vector<vessel> & vessel_data, const int year, 
-							   const vector<landing> & year_data);
-		void simulate_B_season(vector<vessel> & vessel_data, const int year, 
-							   const vector<landing> & year_data);
-		void update_credit_factors(vector<vessel> & vessel_data);
-		void transfer_credits(vector<vessel> & vessel_data, const int year, const vector<landing> & year_data, const int start_index, const int day_index);
+							   const int first_index = 0, int prev_day = -1);
+		void begin_B_season(vector<vessel> & vessel_data);
+		void simulate_B_season(vector<vessel> & vessel_data, const int first_index = -1, int prev_day = -1);
+		void finish_year(vector<vessel> & vessel_data, const int year);
+		void resimulate_year(vector<vessel> & vessel_data, const int year);
+		void save_checkpoint(const CheckpointEvent event, const char season, const int data_index, 
+							 const int prev_day, const int pending_vessel);
+		void restore_checkpoint(const CheckpointEvent event);
+		void set_tax_rate(const double rate);
+		void set_stranding_limit(const double limit);
+		void bank_unused_credits(vessel_state & v);
+		void set_credits(vessel_state & v, const int credits);
+		void reset_fleet_state();
+		void record_fleet_day(const int day);
+		
+		policy_params get_params() const;
+		void set_params(const policy_params & params);
+		credit_factor_ptr get_credit_factors() const;
+		void set_credit_factors(const credit_factor_ptr & credit_factors);
+		credit_factor_db & mutable_credit_factors();
+		int intern_vessel(const string & name, const string & coop);
+		void rewind_run_data(const int num_years);
+		void set_output_prefix(const string & prefix);
+		const string & get_output_prefix() const;
+		bool set_factor_log(const string & filename);
+		void update_credit_factors(vector<vessel> & vessel_data, const int year);
+		void evaluate_penalty(const double * z_scores, double * p_values, const int n);
+		bool load_penalty_curves(const string & filename);
+		bool set_penalty_curve(const string & name);
+		int find_penalty_curve(const string & name) const;
+		void transfer_credits(vector<vessel> & vessel_data, const int start_index, const int day_index);
 		void print_credit_data(vector<vessel> & vessel_data, const int year);
 		void print_vessel_data(vector<vessel> & vessel_data, const int year);
 		void print_credit_deltas(vector<vessel> & vessel_data, const int year);
 		void print_unfished_data();
-		void save_vessel_data(vector<vessel> & vessel_data);
+		void print_floor_prices();
+		void print_fleet_series(const int year);
+		void print_results(vector<vessel> & vessel_data, const int year);
+		void print_summary();
+		void print_database(vector<vessel> & vessel_data, const int year);
+		int set_results_db(results_db * database, const string & label);
+		void set_results_scenarios(results_db * database, const vector<int> & scenarios);
+		void print_run_data();
+		void record_year(const vector<vessel> & vessel_data, const int year);
+		void set_output_sinks(const int sinks);
+		void set_fleet_series(const bool enabled);
+		void flush_output();
+		void save_vessel_data(const int year);
+		bool warm_start(const int year);
+		unsigned long long params_fingerprint(const unsigned long long previous) const;
 		
 	private:
+		int intern_key(const string & key);
+		
 		vector<landing> raw_data;
+		map<int, year_dataset_ptr> year_sets;
+		year_dataset_ptr year_set;		// the year being replayed
+		vector<vessel_state> states;	// replay state of its vessels
+		vector<vessel> year_vessels;	// allocation results, reused every year
+		vector<needy_struct> needy_db;	// transfer_credits scratch
 		vector<string> column_names;
-		vector<credit_factor> credit_factor_DB;
-		vector<double> z_table;
+		credit_factor_ptr credit_factor_DB;
+		factor_log factor_history;
+		penalty_registry penalty_curves;
+		factor_batch factor_update;
 		int num_days;
 		int start_date;
+		vector<double> day_pollock, day_pollock_std;	// fleet totals of the landings data
+		vector<int> day_chinook, day_chinook_std;
+		fleet_state fleet;
+		vector<fleet_state> fleet_series;
+		bool record_fleet_series;
 		double season_pollock_A, season_pollock_B;
 		vector<int> unfished_pollock_A;
 		vector<int> unfished_pollock_B;
 		vector<int> years;
-		map<string, int> vessel_index;
+		vector<floor_price> floor_prices_A, floor_prices_B;
+		unordered_map<string, int> vessel_ids;
+		vector<string> vessel_keys;
+		string output_prefix;
+		output_writer writer;
+		column_file_builder results;
+		int output_sinks;
+		int output_needs;
+		year_summary current_summary;
+		vector<year_summary> summaries;
+		results_db * database;
+		vector<int> scenario_ids;	// each year's DATABASE_SINK rows go to all of these
 		
 		int b_season_first_catch;
 		double bycatch_rate_cap_A, bycatch_rate_cap_B;
 		int season_chinook_A, season_chinook_B;
-		double credits_available, credits_held, credits_transferred;
+		credit_units credits_available, credits_held, credits_transferred;	// fixed point
+		
+		// replay snapshots for the current year
+		sim_checkpoint checkpoints[NUM_CHECKPOINTS];
+		int resume_event;
 		
 		// parameters
 		double HARD_CAP;
@@ -123,7 +333,7 @@ class simulator
 		double BETA;
 		double GAMMA;
 		
-		PenaltyType penalty_func;
+		int penalty_func;
 		SavingType trading_rule;
 		double DELTA;
 		double EPSILON;
@@ -134,6 +344,11 @@ class simulator
 		double TAX_RATE;
 		
 		double PSI;
+		
+		int FLOOR_PRICE_CHINOOK;	// set once; year_sets caches floors computed from it
+		double CREDIT_VALUE_A;	// per lb of pollock
+		double CREDIT_VALUE_B;
+		
 		bool SSR_set;
 		int SSR_set_date;
 	};
@@ -7,8 +7,13 @@
  *
  */
 
+#include <algorithm>
 #include "simulator_tools.h"
 
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 double shallow_slope(const double z_score)
 {
 	if(z_score <= -3)
@@ -59,18 +64,387 @@ double linear(const double z_score)
 	}
 }
 
-double normal_pvalue(const double z_score, const vector<double> & z_table)
+// standard normal CDF on [-3, 3], tabulated from erfc every 1/1024 when the
+// program starts and linearly interpolated; the interpolation error is at most
+// h^2 / 8 * max|z phi(z)| < 3e-8
+const int Z_TABLE_STEPS = 1024;
+const int Z_TABLE_SIZE = 6 * Z_TABLE_STEPS + 1;
+
+static double z_table[Z_TABLE_SIZE];
+
+static bool fill_z_table()
 {
-	if(z_score <= -3)
+	for(int i = 0; i < Z_TABLE_SIZE; i++)
+		z_table[i] = 0.5 * erfc((3.0 - double(i) / Z_TABLE_STEPS) / sqrt(2.0));
+	return true;
+}
+
+static const bool z_table_filled = fill_z_table();
+static const lookup_table normal_lookup = {z_table, Z_TABLE_SIZE, -3.0, Z_TABLE_STEPS, 0.0, 1.0};
+
+double normal_pvalue(const double z_score)
+{
+	return table_lookup(normal_lookup, z_score);
+}
+
+double table_lookup(const lookup_table & table, const double z_score)
+{
+	double z_max = table.z_min + (table.size - 1) / table.steps;
+	if(z_score <= table.z_min)
+	{
+		return table.below;
+	}
+	else if (z_score <= z_max)
+	{
+		double x = (z_score - table.z_min) * table.steps;
+		int z_index = int(x);
+		if(z_index > table.size - 2)
+			z_index = table.size - 2;
+		return table.values[z_index] + (x - z_index) * (table.values[z_index + 1] - table.values[z_index]);
+	}
+	return table.above;
+}
+
+// tan(x) for |x| < 1.4 from a [7/6] Pade approximant at x/2 and the double
+// angle formula; relative error is below 1e-13 on the ranges used by
+// shallow_slope and moderate_slope ([-1.33, -0.52])
+double tan_approx(const double x)
+{
+	double y = 0.5 * x;
+	double y2 = y * y;
+	double t = y * (135135 + y2 * (-17325 + y2 * (378 - y2))) / 
+	(135135 + y2 * (-62370 + y2 * (3150 - 28 * y2)));
+	return 2 * t / (1 - t * t);
+}
+
+#if defined(__AVX512F__)
+
+typedef __m512d vdouble;
+typedef __mmask8 vmask;
+const int VLEN = 8;
+
+static inline vdouble vset(const double a) { return _mm512_set1_pd(a); }
+static inline vdouble vload(const double * p) { return _mm512_loadu_pd(p); }
+static inline void vstore(double * p, const vdouble a) { _mm512_storeu_pd(p, a); }
+static inline vdouble vadd(const vdouble a, const vdouble b) { return _mm512_add_pd(a, b); }
+static inline vdouble vsub(const vdouble a, const vdouble b) { return _mm512_sub_pd(a, b); }
+static inline vdouble vmul(const vdouble a, const vdouble b) { return _mm512_mul_pd(a, b); }
+static inline vdouble vdiv(const vdouble a, const vdouble b) { return _mm512_div_pd(a, b); }
+static inline vdouble vmin(const vdouble a, const vdouble b) { return _mm512_min_pd(a, b); }
+static inline vdouble vmax(const vdouble a, const vdouble b) { return _mm512_max_pd(a, b); }
+static inline vmask vle(const vdouble a, const vdouble b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+static inline vmask vge(const vdouble a, const vdouble b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+static inline vdouble vselect(const vmask m, const vdouble a, const vdouble b) { return _mm512_mask_blend_pd(m, b, a); }
+static inline vdouble vfloor(const vdouble a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF); }
+static inline vdouble vlookup(const double * table, const vdouble x)
+{
+	return _mm512_i32gather_pd(_mm512_cvttpd_epi32(x), table, 8);
+}
+static inline int vbits(const vmask m) { return m; }
+static inline vdouble vlast(const vdouble a) { return _mm512_permutexvar_pd(_mm512_set1_epi64(7), a); }
+
+// running sum across the lanes: log2(VLEN) shifted adds
+static inline vdouble vscan(vdouble a)
+{
+	a = vadd(a, _mm512_maskz_permutexvar_pd(0xFE, _mm512_set_epi64(6, 5, 4, 3, 2, 1, 0, 0), a));
+	a = vadd(a, _mm512_maskz_permutexvar_pd(0xFC, _mm512_set_epi64(5, 4, 3, 2, 1, 0, 0, 0), a));
+	a = vadd(a, _mm512_maskz_permutexvar_pd(0xF0, _mm512_set_epi64(3, 2, 1, 0, 0, 0, 0, 0), a));
+	return a;
+}
+
+#elif defined(__AVX2__)
+
+typedef __m256d vdouble;
+typedef __m256d vmask;
+const int VLEN = 4;
+
+static inline vdouble vset(const double a) { return _mm256_set1_pd(a); }
+static inline vdouble vload(const double * p) { return _mm256_loadu_pd(p); }
+static inline void vstore(double * p, const vdouble a) { _mm256_storeu_pd(p, a); }
+static inline vdouble vadd(const vdouble a, const vdouble b) { return _mm256_add_pd(a, b); }
+static inline vdouble vsub(const vdouble a, const vdouble b) { return _mm256_sub_pd(a, b); }
+static inline vdouble vmul(const vdouble a, const vdouble b) { return _mm256_mul_pd(a, b); }
+static inline vdouble vdiv(const vdouble a, const vdouble b) { return _mm256_div_pd(a, b); }
+static inline vdouble vmin(const vdouble a, const vdouble b) { return _mm256_min_pd(a, b); }
+static inline vdouble vmax(const vdouble a, const vdouble b) { return _mm256_max_pd(a, b); }
+static inline vmask vle(const vdouble a, const vdouble b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+static inline vmask vge(const vdouble a, const vdouble b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+static inline vdouble vselect(const vmask m, const vdouble a, const vdouble b) { return _mm256_blendv_pd(b, a, m); }
+static inline vdouble vfloor(const vdouble a) { return _mm256_floor_pd(a); }
+static inline vdouble vlookup(const double * table, const vdouble x)
+{
+	return _mm256_i32gather_pd(table, _mm256_cvttpd_epi32(x), 8);
+}
+static inline int vbits(const vmask m) { return _mm256_movemask_pd(m); }
+static inline vdouble vlast(const vdouble a) { return _mm256_permute4x64_pd(a, 0xFF); }
+
+// running sum across the lanes: log2(VLEN) shifted adds
+static inline vdouble vscan(vdouble a)
+{
+	a = vadd(a, _mm256_blend_pd(_mm256_permute4x64_pd(a, 0x90), _mm256_setzero_pd(), 0x1));
+	a = vadd(a, _mm256_blend_pd(_mm256_permute4x64_pd(a, 0x40), _mm256_setzero_pd(), 0x3));
+	return a;
+}
+
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+
+// vector form of tan_approx
+static inline vdouble vtan(const vdouble x)
+{
+	vdouble y = vmul(vset(0.5), x);
+	vdouble y2 = vmul(y, y);
+	vdouble num = vmul(y, vadd(vset(135135), vmul(y2, vadd(vset(-17325), vmul(y2, vsub(vset(378), y2))))));
+	vdouble den = vadd(vset(135135), vmul(y2, vadd(vset(-62370), vmul(y2, vsub(vset(3150), vmul(vset(28), y2))))));
+	vdouble t = vdiv(num, den);
+	return vdiv(vmul(vset(2), t), vsub(vset(1), vmul(t, t)));
+}
+
+#endif
+
+// each kernel evaluates every piece on every lane and keeps the right one with
+// blend masks; the tan argument is clamped to its own piece so the unused lanes
+// stay finite. Masks are applied from the last branch of the scalar version to
+// the first, so NaN inputs give the same result as the scalar version.
+
+void shallow_slope_batch(const double * z_scores, double * p_values, const int n)
+{
+	int i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+	for(; i + VLEN <= n; i += VLEN)
+	{
+		vdouble z = vload(z_scores + i);
+		vdouble zc = vmin(vmax(z, vset(-3)), vset(-1));
+		vdouble curve = vadd(vmul(vset(0.2), vtan(vadd(vmul(vset(0.3984606), zc), vset(-0.1247462)))), vset(0.7810852));
+		vdouble line = vadd(vmul(vset(1.0 / 12.0), z), vset(0.75));
+		vdouble p = vset(1);
+		p = vselect(vle(z, vset(3)), line, p);
+		p = vselect(vle(z, vset(-1)), curve, p);
+		p = vselect(vle(z, vset(-3)), vset(0), p);
+		vstore(p_values + i, p);
+	}
+#endif
+	for(; i < n; i++)
+		p_values[i] = shallow_slope(z_scores[i]);
+	return;
+}
+
+void moderate_slope_batch(const double * z_scores, double * p_values, const int n)
+{
+	int i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+	for(; i + VLEN <= n; i += VLEN)
+	{
+		vdouble z = vload(z_scores + i);
+		vdouble zc = vmin(vmax(z, vset(-2)), vset(-1));
+		vdouble curve = vadd(vmul(vset(0.2), vtan(vadd(vmul(vset(0.57006), zc), vset(-0.02800249)))), vset(0.4695404));
+		vdouble line = vadd(vmul(vset(1.0 / 6.0), z), vset(0.5));
+		vdouble p = vset(1);
+		p = vselect(vle(z, vset(3)), line, p);
+		p = vselect(vle(z, vset(-1)), curve, p);
+		p = vselect(vle(z, vset(-2)), vset(0), p);
+		vstore(p_values + i, p);
+	}
+#endif
+	for(; i < n; i++)
+		p_values[i] = moderate_slope(z_scores[i]);
+	return;
+}
+
+void linear_batch(const double * z_scores, double * p_values, const int n)
+{
+	int i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+	for(; i + VLEN <= n; i += VLEN)
 	{
+		vdouble z = vload(z_scores + i);
+		vdouble p = vdiv(vadd(z, vset(2)), vset(4));
+		p = vselect(vge(z, vset(2)), vset(1), p);
+		p = vselect(vle(z, vset(-2)), vset(0), p);
+		vstore(p_values + i, p);
+	}
+#endif
+	for(; i < n; i++)
+		p_values[i] = linear(z_scores[i]);
+	return;
+}
+
+void normal_pvalue_batch(const double * z_scores, double * p_values, const int n)
+{
+	table_lookup_batch(normal_lookup, z_scores, p_values, n);
+	return;
+}
+
+void table_lookup_batch(const lookup_table & table, const double * z_scores, double * p_values, const int n)
+{
+	int i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+	double z_max = table.z_min + (table.size - 1) / table.steps;
+	for(; i + VLEN <= n; i += VLEN)
+	{
+		vdouble z = vload(z_scores + i);
+		vdouble zc = vmin(vmax(z, vset(table.z_min)), vset(z_max));
+		vdouble x = vmul(vsub(zc, vset(table.z_min)), vset(table.steps));
+		vdouble index = vmin(vfloor(x), vset(table.size - 2));
+		vdouble lower = vlookup(table.values, index);
+		vdouble upper = vlookup(table.values + 1, index);
+		vdouble p = vset(table.above);
+		p = vselect(vle(z, vset(z_max)), vadd(lower, vmul(vsub(x, index), vsub(upper, lower))), p);
+		p = vselect(vle(z, vset(table.z_min)), vset(table.below), p);
+		vstore(p_values + i, p);
+	}
+#endif
+	for(; i < n; i++)
+		p_values[i] = table_lookup(table, z_scores[i]);
+	return;
+}
+
+// largest difference between the batched kernels and the scalar reference
+// over a fine grid of z-scores
+double penalty_batch_error()
+{
+	int n = 8001;
+	vector<double> z(n), p(n);
+	double error = 0;
+	for(int i = 0; i < n; i++)
+		z[i] = -4.0 + 8.0 * i / (n - 1);
+	
+	shallow_slope_batch(&z[0], &p[0], n);
+	for(int i = 0; i < n; i++)
+		error = max(error, fabs(p[i] - shallow_slope(z[i])));
+	moderate_slope_batch(&z[0], &p[0], n);
+	for(int i = 0; i < n; i++)
+		error = max(error, fabs(p[i] - moderate_slope(z[i])));
+	linear_batch(&z[0], &p[0], n);
+	for(int i = 0; i < n; i++)
+		error = max(error, fabs(p[i] - linear(z[i])));
+	normal_pvalue_batch(&z[0], &p[0], n);
+	for(int i = 0; i < n; i++)
+		error = max(error, fabs(p[i] - normal_pvalue(z[i])));
+	return error;
+}
+
+credit_units to_credit_units(const int credits)
+{
+	return credits * CREDIT_SCALE;
+}
+
+double from_credit_units(const credit_units units)
+{
+	return double(units) / CREDIT_SCALE;
+}
+
+// the part of units given by fraction, rounded to the nearest unit
+credit_units split_credit_units(const credit_units units, const double fraction)
+{
+	if(!(fraction > 0))
 		return 0;
+	if(fraction >= 1)
+		return units;
+	return llround(double(units) * fraction);
+}
+
+// in-place running sums; each vector of values is summed across its lanes
+// and then offset by the total so far
+void prefix_sum(double * values, const int n)
+{
+	int i = 0;
+	double total = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+	vdouble carry = vset(0);
+	for(; i + VLEN <= n; i += VLEN)
+	{
+		vdouble sums = vadd(vscan(vload(values + i)), carry);
+		vstore(values + i, sums);
+		carry = vlast(sums);
 	}
-	else if (z_score <= 3)
+	if(i > 0)
+		total = values[i - 1];
+#endif
+	for(; i < n; i++)
 	{
-		int z_index = int(100 * (z_score + 3));
-		return z_table[z_index];
+		total += values[i];
+		values[i] = total;
 	}
-	return 1;
+	return;
+}
+
+void prefix_sum(int * values, const int n)
+{
+	int i = 0;
+	int total = 0;
+#if defined(__AVX2__)
+	__m256i carry = _mm256_setzero_si256();
+	for(; i + 8 <= n; i += 8)
+	{
+		// running sums within each 128-bit half, then the lower half's
+		// total is added to the upper half
+		__m256i sums = _mm256_loadu_si256((const __m256i *) (values + i));
+		sums = _mm256_add_epi32(sums, _mm256_slli_si256(sums, 4));
+		sums = _mm256_add_epi32(sums, _mm256_slli_si256(sums, 8));
+		sums = _mm256_add_epi32(sums, _mm256_shuffle_epi32(_mm256_permute2x128_si256(sums, sums, 0x08), 0xFF));
+		sums = _mm256_add_epi32(sums, carry);
+		_mm256_storeu_si256((__m256i *) (values + i), sums);
+		carry = _mm256_permutevar8x32_epi32(sums, _mm256_set1_epi32(7));
+	}
+	if(i > 0)
+		total = values[i - 1];
+#endif
+	for(; i < n; i++)
+	{
+		total += values[i];
+		values[i] = total;
+	}
+	return;
+}
+
+// index of the first value at or above threshold, n if there is none
+int first_at_least(const double * values, const int n, const double threshold)
+{
+	int i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+	for(; i + VLEN <= n; i += VLEN)
+	{
+		int hits = vbits(vge(vload(values + i), vset(threshold)));
+		if(hits != 0)
+			return i + __builtin_ctz(hits);
+	}
+#endif
+	for(; i < n; i++)
+	{
+		if(values[i] >= threshold)
+			return i;
+	}
+	return n;
+}
+
+void running_max::clear()
+{
+	heap.clear();
+	current.clear();
+	return;
+}
+
+void running_max::set(const int key, const double value)
+{
+	if(key >= current.size())
+		current.resize(key + 1, 0);
+	current[key] = value;
+	heap.push_back(make_pair(value, key));
+	push_heap(heap.begin(), heap.end());
+	return;
+}
+
+double running_max::max()
+{
+	// the top is only valid while it is still its key's current value
+	while(!heap.empty() && heap.front().first != current[heap.front().second])
+	{
+		pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
+	}
+	return heap.empty() ? 0 : heap.front().first;
 }
 
 string parse_line(string line_buffer, int& position)
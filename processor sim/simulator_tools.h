@@ -12,6 +12,7 @@
 
 #include <string>
 #include <vector>
+#include <utility>
 #include "math.h"
 
 using namespace std;
@@ -19,7 +20,66 @@ using namespace std;
 double shallow_slope(const double z_score);
 double moderate_slope(const double z_score);
 double linear(const double z_score);
-double normal_pvalue(const double z_score, const vector<double> & z_table);
+double normal_pvalue(const double z_score);
+
+// dense table of a curve sampled every 1/steps from z_min, linearly
+// interpolated; z <= z_min gives below and z past the last entry gives above
+struct lookup_table
+{
+	const double * values;
+	int size;
+	double z_min;
+	double steps;
+	double below;
+	double above;
+};
+
+double table_lookup(const lookup_table & table, const double z_score);
+void table_lookup_batch(const lookup_table & table, const double * z_scores, double * p_values, const int n);
+
+// batched forms of the penalty functions; p_values[i] is the penalty for
+// z_scores[i]. These use AVX-512 or AVX2 when the build enables them and
+// fall back to the scalar functions above otherwise. The simulation does not
+// call them: every curve, built in or not, goes through the penalty registry's
+// lookup tables (table_lookup_batch), and these are kept as vector references
+// for the closed forms, checked by penalty_batch_error in -verify.
+void shallow_slope_batch(const double * z_scores, double * p_values, const int n);
+void moderate_slope_batch(const double * z_scores, double * p_values, const int n);
+void linear_batch(const double * z_scores, double * p_values, const int n);
+void normal_pvalue_batch(const double * z_scores, double * p_values, const int n);
+// credit pools are counted in fixed point, CREDIT_SCALE units to the credit,
+// so pooling and transfers add up exactly on every compiler. A pool is only
+// ever split in two: one part is rounded to the nearest unit (halves away
+// from zero) and the other part is the rest, so no units are made or lost.
+typedef long long credit_units;
+const credit_units CREDIT_SCALE = 1LL << 20;
+
+credit_units to_credit_units(const int credits);
+double from_credit_units(const credit_units units);
+credit_units split_credit_units(const credit_units units, const double fraction);
+
+// in-place running sums, and the first value to reach a threshold; these use
+// AVX-512 or AVX2 when the build enables them
+void prefix_sum(double * values, const int n);
+void prefix_sum(int * values, const int n);
+int first_at_least(const double * values, const int n, const double threshold);
+
+// largest of a set of keyed values that change one at a time; each set() is
+// O(log n), and entries it supersedes are dropped when the maximum is read
+class running_max
+	{
+	public:
+		void clear();
+		void set(const int key, const double value);
+		double max();		// 0 when nothing has been set
+		
+	private:
+		vector<pair<double, int> > heap;
+		vector<double> current;
+	};
+
+double tan_approx(const double x);
+double penalty_batch_error();
 
 string parse_line(string line_buffer, int& position);
 int parse_month(string value_buffer);
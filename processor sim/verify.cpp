@@ -0,0 +1,956 @@
+/*
+ *  verify.cpp
+ *  processor
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "verify.h"
+#include "simulator.h"
+#include "scenario_tree.h"
+#include "csv_buffer.h"
+#include "alloc_counter.h"
+
+// mismatches listed per file before the rest are only counted
+const int MAX_REPORTED_MISMATCHES = 10;
+
+verify_options default_verify_options()
+{
+	verify_options options;
+	options.landings_file = "cv_sector_data.csv";
+	options.golden_dir = "golden/";
+	options.output_dir = "verify_output/";
+	options.report_file = "verify_report.json";
+	options.runs = 1;
+	options.tolerance = 1e-6;
+	options.penalty_tolerance = 1e-10;
+	return options;
+}
+
+static bool is_integer(const string & field)
+{
+	if(field.empty())
+		return false;
+	int start = (field[0] == '-') ? 1 : 0;
+	if(start == field.length())
+		return false;
+	for(int i = start; i < field.length(); i++)
+	{
+		if(field[i] < '0' || field[i] > '9')
+			return false;
+	}
+	return true;
+}
+
+static bool is_number(const string & field, double & value)
+{
+	if(field.empty())
+		return false;
+	char * end;
+	value = strtod(field.c_str(), &end);
+	return *end == 0;
+}
+
+static bool fields_match(const string & golden, const string & output, const double tolerance)
+{
+	if(golden == output)
+		return true;
+	
+	double a, b;
+	if(is_integer(golden) || is_integer(output) || !is_number(golden, a) || !is_number(output, b))
+		return false;
+	if(isnan(a) || isnan(b))
+		return isnan(a) && isnan(b);
+	return fabs(a - b) <= tolerance * max(fabs(a), fabs(b));
+}
+
+static void split_fields(const string & line, vector<string> & fields, const char separator = ',')
+{
+	fields.clear();
+	int position = 0;
+	while(true)
+	{
+		int end = line.find(separator, position);
+		if(end == string::npos)
+		{
+			fields.push_back(line.substr(position));
+			break;
+		}
+		fields.push_back(line.substr(position, end - position));
+		position = end + 1;
+	}
+	return;
+}
+
+// returns the number of mismatched fields (a missing file or line counts as one)
+int compare_csv(const string & golden_file, const string & output_file, const double tolerance, 
+				vector<string> & mismatches)
+{
+	ifstream golden, output;
+	golden.open(golden_file.c_str());
+	output.open(output_file.c_str());
+	if(!output.is_open())
+	{
+		mismatches.push_back(output_file + " was not written");
+		return 1;
+	}
+	
+	string golden_line, output_line;
+	vector<string> golden_fields, output_fields;
+	int line_number = 0;
+	int count = 0;
+	char location[64];
+	
+	while(true)
+	{
+		bool more_golden = bool(getline(golden, golden_line));
+		bool more_output = bool(getline(output, output_line));
+		line_number++;
+		if(!more_golden && !more_output)
+			break;
+		if(more_golden != more_output)
+		{
+			sprintf(location, ":%d: ", line_number);
+			mismatches.push_back(output_file + location + (more_golden ? "missing lines" : "extra lines"));
+			return count + 1;
+		}
+		
+		split_fields(golden_line, golden_fields);
+		split_fields(output_line, output_fields);
+		if(golden_fields.size() != output_fields.size())
+		{
+			sprintf(location, ":%d: ", line_number);
+			mismatches.push_back(output_file + location + "different number of fields");
+			count++;
+			continue;
+		}
+		for(int k = 0; k < golden_fields.size(); k++)
+		{
+			if(fields_match(golden_fields[k], output_fields[k], tolerance))
+				continue;
+			if(count < MAX_REPORTED_MISMATCHES)
+			{
+				sprintf(location, ":%d:%d: ", line_number, k + 1);
+				mismatches.push_back(output_file + location + golden_fields[k] + " != " + output_fields[k]);
+			}
+			count++;
+		}
+	}
+	return count;
+}
+
+// swallows the per-year reports without growing a buffer
+class discard_buffer : public streambuf
+	{
+	protected:
+		int overflow(int c)
+		{
+			return c;
+		}
+	};
+
+// heap allocations made by full runs with every output sink off, after one
+// warm-up run has sized the pooled buffers; a steady-state run should make none
+static long long steady_state_allocations(simulator & my_simulator, const int runs)
+{
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	my_simulator.set_output_sinks(0);
+	my_simulator.process();
+	
+	long long start = allocation_count();
+	set_allocation_counting(true);
+	for(int run = 0; run < runs; run++)
+		my_simulator.process();
+	set_allocation_counting(false);
+	long long count = allocation_count() - start;
+	
+	cerr.rdbuf(cerr_buffer);
+	return count;
+}
+
+static void replay_year(simulator & my_simulator, const int year, vector<vessel> & vessel_data)
+{
+	my_simulator.begin_year(my_simulator.load_year(year), vessel_data);
+	my_simulator.load_credit_factors(vessel_data);
+	my_simulator.process_data(vessel_data, year);
+	my_simulator.simulate_year(vessel_data, year);
+	return;
+}
+
+static bool same_state(const vessel_state & a, const vessel_state & b)
+{
+	return a.credits == b.credits && a.actual_chinook_A == b.actual_chinook_A && 
+	a.actual_chinook_B == b.actual_chinook_B && a.out_date_A == b.out_date_A && 
+	a.out_date_B == b.out_date_B && a.actual_pollock_A == b.actual_pollock_A && 
+	a.actual_pollock_B == b.actual_pollock_B && a.done_A == b.done_A && a.done_B == b.done_B && 
+	a.hit_A_limit == b.hit_A_limit && a.hit_B_limit == b.hit_B_limit;
+}
+
+static bool same_fleet(const fleet_state & a, const fleet_state & b)
+{
+	return a.credits == b.credits && a.vessels_out == b.vessels_out && 
+	a.actual_pollock_A == b.actual_pollock_A && a.actual_pollock_B == b.actual_pollock_B && 
+	a.actual_chinook_A == b.actual_chinook_A && a.actual_chinook_B == b.actual_chinook_B && 
+	a.credits_available == b.credits_available && a.credits_held == b.credits_held && 
+	a.credits_transferred == b.credits_transferred;
+}
+
+// changes the stranding limit (dynamic salmon savings) or the transfer tax
+// (fixed tax) after a replay and resumes it from the checkpoint, then compares
+// the vessel states and fleet totals with a fresh replay that had the new
+// value from the start; returns the number of years that differ
+static int resume_mismatches(const vector<landing> & landings, vector<string> & mismatches)
+{
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	int count = 0;
+	char location[64];
+	
+	for(int rule = 0; rule < 2; rule++)
+	{
+		simulator resumed, fresh;
+		resumed.set_output_sinks(0);
+		fresh.set_output_sinks(0);
+		resumed.set_landings(landings);
+		fresh.set_landings(landings);
+		
+		policy_params before = resumed.get_params();
+		before.trading_rule = (rule == 0) ? DYNAMIC_SALMON_SAVINGS : FIXED_TRANSFER_TAX;
+		policy_params after = before;
+		if(rule == 0)
+			after.DYNAMIC_STRANDING_LIMIT = 0.45;
+		else
+			after.TAX_RATE = 0.35;
+		fresh.set_params(after);
+		
+		vector<vessel> resumed_data, fresh_data;
+		for(int year = 2000; year <= 2007; year++)
+		{
+			resumed.set_params(before);
+			replay_year(resumed, year, resumed_data);
+			if(rule == 0)
+				resumed.set_stranding_limit(after.DYNAMIC_STRANDING_LIMIT);
+			else
+				resumed.set_tax_rate(after.TAX_RATE);
+			resumed.resimulate_year(resumed_data, year);
+			replay_year(fresh, year, fresh_data);
+			
+			const vector<vessel_state> & a = resumed.get_vessel_states();
+			const vector<vessel_state> & b = fresh.get_vessel_states();
+			fleet_state fa = resumed.get_fleet_state();
+			fleet_state fb = fresh.get_fleet_state();
+			bool same = (a.size() == b.size() && same_fleet(fa, fb));
+			for(int i = 0; same && i < a.size(); i++)
+				same = same_state(a[i], b[i]);
+			if(!same)
+			{
+				sprintf(location, "%d (%s)", year, rule == 0 ? "stranding limit" : "transfer tax");
+				mismatches.push_back(string("resumed replay differs from a fresh one for ") + location);
+				count++;
+			}
+		}
+	}
+	
+	cerr.rdbuf(cerr_buffer);
+	return count;
+}
+
+// writes one run to a new results database and reads back the row count of
+// every table, with a second connection to the file (as another process
+// would have) adding a scenario of its own; returns the number of tables with
+// the wrong count (and clashing ids), or -1 in a build without SQLite
+static int database_mismatches(const vector<landing> & landings, const string & filename, 
+							   vector<string> & mismatches)
+{
+#ifdef HAVE_SQLITE
+	remove(filename.c_str());
+	remove((filename + "-wal").c_str());
+	remove((filename + "-shm").c_str());
+	results_db database, other;
+	if(!database.open(filename) || !other.open(filename))
+	{
+		mismatches.push_back("could not open " + filename);
+		return NUM_RESULTS_TABLES;
+	}
+	
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	simulator my_simulator;
+	my_simulator.set_landings(landings);
+	my_simulator.set_output_sinks(DATABASE_SINK);
+	int scenario = my_simulator.set_results_db(&database, "verify");
+	int other_scenario = other.add_scenario("verify, second connection");
+	my_simulator.process();
+	cerr.rdbuf(cerr_buffer);
+	other.close();
+	
+	long long expected[NUM_RESULTS_TABLES] = {1, 0, 0, 0};
+	for(int year = 2000; year <= 2007; year++)
+	{
+		expected[PARAMETERS_TABLE]++;
+		expected[SUMMARIES_TABLE]++;
+		expected[VESSELS_TABLE] += my_simulator.load_year(year)->vessels.size();
+	}
+	
+	const char * names[NUM_RESULTS_TABLES] = {"scenarios", "parameters", "summaries", "vessels"};
+	int count = 0;
+	char counts[64];
+	if(scenario <= 0 || other_scenario == scenario)
+	{
+		mismatches.push_back(filename + ": two connections were given the same scenario id");
+		count++;
+	}
+	for(int t = 0; t < NUM_RESULTS_TABLES; t++)
+	{
+		long long rows = database.count_rows(t, scenario);
+		if(rows == expected[t])
+			continue;
+		sprintf(counts, " has %lld rows, expected %lld", rows, expected[t]);
+		mismatches.push_back(filename + ": " + names[t] + counts);
+		count++;
+	}
+	database.close();
+	return count;
+#else
+	(void)landings;
+	(void)filename;
+	(void)mismatches;
+	return -1;
+#endif
+}
+
+// logs the credit factors of two runs to one file, the second with its vessel
+// ids interned in the opposite order, reads the log back and checks that every
+// record names the vessel its run gave that id, that the last record of every
+// vessel and season holds the factors its run ended with, and that the log
+// replays to one CSV row per record; returns the number of problems found
+static int factor_log_mismatches(const vector<landing> & landings, const string & log_filename, 
+								 const string & csv_filename, vector<string> & mismatches)
+{
+	remove(log_filename.c_str());
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	simulator runs[2];
+	bool opened = true;
+	for(int run = 0; run < 2; run++)
+	{
+		for(int i = landings.size() - 1; run == 1 && i >= 0; i--)
+			runs[run].intern_vessel(landings[i].name, landings[i].coop);
+		runs[run].set_landings(landings);
+		runs[run].set_output_sinks(0);
+		opened = runs[run].set_factor_log(log_filename) && opened;
+		runs[run].process();
+		runs[run].set_factor_log("");
+	}
+	cerr.rdbuf(cerr_buffer);
+	if(!opened)
+	{
+		mismatches.push_back("could not open " + log_filename);
+		return 1;
+	}
+	
+	vector<factor_log_record> records;
+	vector<string> names, coops;
+	if(!read_factor_log(log_filename, records, names, coops) || records.empty())
+	{
+		mismatches.push_back("could not read back " + log_filename);
+		return 1;
+	}
+	
+	int count = 0;
+	vector<char> checked[2];
+	for(int run = 0; run < 2; run++)
+		checked[run].assign(2 * runs[run].get_credit_factors()->size(), false);
+	for(int i = records.size() - 1; i >= 0; i--)
+	{
+		const factor_log_record & r = records[i];
+		int id = r.vessel_id;
+		if(r.run < 0 || r.run > 1 || id < 0 || id >= runs[r.run].get_credit_factors()->size() || 
+		   names[i].empty() || runs[r.run].intern_vessel(names[i], coops[i]) != id)
+		{
+			count++;
+			continue;
+		}
+		const credit_factor_db & factors = *runs[r.run].get_credit_factors();
+		int slot = 2 * id + (r.season == 'B');
+		if(checked[r.run][slot])
+			continue;
+		checked[r.run][slot] = true;
+		bool A = (r.season == 'A');
+		if(r.p != (A ? factors.p_A[id] : factors.p_B[id]) || r.q != (A ? factors.q_A[id] : factors.q_B[id]) || 
+		   r.cim != (A ? factors.cim_A[id] : factors.cim_B[id]))
+			count++;
+	}
+	if(count > 0)
+		mismatches.push_back(log_filename + ": records that do not match their run's vessels and credit factors");
+	if(records.back().run != 1)
+	{
+		mismatches.push_back(log_filename + ": the second run was not logged as a run of its own");
+		count++;
+	}
+	
+	print_factor_log(log_filename, csv_filename);
+	ifstream csv(csv_filename.c_str());
+	string line;
+	int num_lines = 0;
+	while(getline(csv, line))
+		num_lines++;
+	if(num_lines != records.size() + 1)
+	{
+		mismatches.push_back(csv_filename + ": wrong number of rows");
+		count++;
+	}
+	return count;
+}
+
+// runs a sweep file as a scenario tree, then each of its scenarios on its own
+// from fresh credit factors with that scenario's parameters year by year, and
+// compares the output files, which must be the same; the tree must share the
+// common years and its branches must differ, or a bad fork could go unseen. In
+// HAVE_SQLITE builds every scenario must also get its own database rows.
+// Returns the number of files (or checks) that differ
+static int sweep_mismatches(const vector<landing> & landings, const string & output_dir, 
+							vector<string> & mismatches)
+{
+	string sweep_file = output_dir + "sweep.txt";
+	ofstream sweep(sweep_file.c_str());
+	sweep << "# the unchanged run, a lower target from 2004, and a new allocation from 2006 on top of that\n";
+	sweep << "2000\n";
+	sweep << "2004 TARGET_CAP=40000\n";
+	sweep << "2004 TARGET_CAP=40000 2006 ALPHA=0.5 BETA=0.25 GAMMA=0.25\n";
+	sweep.close();
+	
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	simulator my_simulator;
+	my_simulator.set_landings(landings);
+	my_simulator.set_output_sinks(CSV_SINK | SUMMARY_SINK);
+	my_simulator.set_output_prefix(output_dir + "sweep.");
+	scenario_tree tree(my_simulator, 2000);
+	int num_scenarios = tree.load(sweep_file);
+#ifdef HAVE_SQLITE
+	string database_file = output_dir + "sweep.sqlite";
+	remove(database_file.c_str());
+	remove((database_file + "-wal").c_str());
+	remove((database_file + "-shm").c_str());
+	results_db database;
+	if(database.open(database_file))
+	{
+		my_simulator.set_output_sinks(CSV_SINK | SUMMARY_SINK | DATABASE_SINK);
+		tree.set_results_db(&database, "verify");
+	}
+#endif
+	tree.run();
+	
+	// the same scenarios one at a time
+	char prefix[40];
+	for(int k = 0; k < num_scenarios; k++)
+	{
+		sprintf(prefix, "leaf_%d.", k);
+		my_simulator.set_output_prefix(output_dir + prefix);
+		my_simulator.set_credit_factors(credit_factor_ptr(new credit_factor_db));
+		my_simulator.rewind_run_data(0);
+		for(int year = 2000; year <= LAST_SWEEP_YEAR; year++)
+		{
+			my_simulator.set_params(tree.year_params(k, year));
+			my_simulator.process_year(year);
+		}
+		my_simulator.print_run_data();
+	}
+	my_simulator.flush_output();
+	cerr.rdbuf(cerr_buffer);
+	
+	if(num_scenarios != 3 || tree.num_nodes() != 14)
+	{
+		mismatches.push_back(sweep_file + ": the scenarios do not share their common years");
+		return 1;
+	}
+	
+	const char * year_files[2] = {"credit_supply_demand.%d.csv", "vessel_data.%d.csv"};
+	const char * run_files[3] = {"unfished_pollock.csv", "floor_prices.csv", "summary_output.txt"};
+	char name[40];
+	int count = 0;
+	for(int k = 0; k < num_scenarios; k++)
+	{
+		sprintf(prefix, "leaf_%d.", k);
+		for(int year = 2000; year <= LAST_SWEEP_YEAR; year++)
+		{
+			for(int f = 0; f < 2; f++)
+			{
+				sprintf(name, year_files[f], year);
+				if(compare_csv(tree.year_prefix(k, year) + name, output_dir + prefix + name, 0, mismatches) > 0)
+					count++;
+			}
+		}
+		for(int f = 0; f < 3; f++)
+		{
+			if(compare_csv(tree.scenario_prefix(k) + run_files[f], output_dir + prefix + run_files[f], 0, mismatches) > 0)
+				count++;
+		}
+	}
+	
+	// where the scenarios fork, the branches must go different ways
+	vector<string> differences;
+	if(compare_csv(tree.year_prefix(0, 2004) + "vessel_data.2004.csv", 
+				   tree.year_prefix(1, 2004) + "vessel_data.2004.csv", 0, differences) == 0 || 
+	   compare_csv(tree.year_prefix(1, 2006) + "vessel_data.2006.csv", 
+				   tree.year_prefix(2, 2006) + "vessel_data.2006.csv", 0, differences) == 0)
+	{
+		mismatches.push_back(sweep_file + ": the branches of the sweep do not differ");
+		count++;
+	}
+	
+#ifdef HAVE_SQLITE
+	char counts[64];
+	int num_years = LAST_SWEEP_YEAR - 2000 + 1;
+	for(int k = 0; database.is_open() && k < num_scenarios; k++)
+	{
+		long long parameter_rows = database.count_rows(PARAMETERS_TABLE, tree.results_scenario(k));
+		long long summary_rows = database.count_rows(SUMMARIES_TABLE, tree.results_scenario(k));
+		if(parameter_rows == num_years && summary_rows == num_years)
+			continue;
+		sprintf(counts, ": scenario %d has %lld parameter and %lld summary rows", k, parameter_rows, summary_rows);
+		mismatches.push_back(database_file + counts);
+		count++;
+	}
+	database.close();
+#endif
+	return count;
+}
+
+// defines two penalty curves in a file and runs each: a copy of the built-in
+// linear curve from its control points, which must reproduce the golden
+// files, and a steeper curve, which must change them; returns the number of
+// problems found
+static int penalty_curve_mismatches(const vector<landing> & landings, const verify_options & options, 
+									const vector<string> & golden_files, vector<string> & mismatches)
+{
+	string curve_file = options.output_dir + "penalty_curves.txt";
+	ofstream curves(curve_file.c_str());
+	curves << "# the built-in linear curve, and a steeper one\n";
+	curves << "linear_points linear -2,0 2,1\n";
+	curves << "steep spline -1,0 0,0.2 1,1\n";
+	curves.close();
+	
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	simulator my_simulator;
+	my_simulator.set_landings(landings);
+	my_simulator.set_output_sinks(CSV_SINK);
+	bool loaded = my_simulator.load_penalty_curves(curve_file);
+	
+	const char * names[2] = {"linear_points", "steep"};
+	vector<string> differences;
+	int count = 0;
+	int changed = 0;
+	for(int c = 0; c < 2; c++)
+	{
+		if(!loaded || !my_simulator.set_penalty_curve(names[c]))
+		{
+			mismatches.push_back(curve_file + ": could not use " + names[c]);
+			count++;
+			continue;
+		}
+		string prefix = options.output_dir + "curve_" + names[c] + ".";
+		my_simulator.set_output_prefix(prefix);
+		my_simulator.process();
+		for(int i = 0; i < golden_files.size(); i++)
+		{
+			int fields = compare_csv(options.golden_dir + golden_files[i], prefix + golden_files[i], 
+									 options.tolerance, c == 0 ? mismatches : differences);
+			if(fields > 0 && c == 0)
+				count++;
+			if(fields > 0 && c == 1)
+				changed++;
+		}
+	}
+	cerr.rdbuf(cerr_buffer);
+	
+	if(loaded && changed == 0)
+	{
+		mismatches.push_back(curve_file + ": the steep curve did not change the run");
+		count++;
+	}
+	return count;
+}
+
+// names of the files in a directory
+static void list_files(const string & directory, vector<string> & names)
+{
+	names.clear();
+	DIR * dir = opendir(directory.c_str());
+	if(dir == NULL)
+		return;
+	struct dirent * entry;
+	while((entry = readdir(dir)) != NULL)
+	{
+		string name = entry->d_name;
+		if(name != "." && name != "..")
+			names.push_back(name);
+	}
+	closedir(dir);
+	return;
+}
+
+// runs with only the summary sink into a directory of its own: the summary
+// must have a row for every year with the credits distributed and used that
+// the TOTAL rows of the golden vessel_data files show, and nothing but the
+// summary (and an INSTRUMENT build's profile) may be written; returns the
+// number of problems found
+static int summary_mismatches(const vector<landing> & landings, const verify_options & options, 
+							  vector<string> & mismatches)
+{
+	string directory = options.output_dir + "summary_only/";
+	vector<string> names;
+	mkdir(directory.c_str(), 0755);
+	list_files(directory, names);
+	for(int i = 0; i < names.size(); i++)
+		remove((directory + names[i]).c_str());
+	
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	simulator my_simulator;
+	my_simulator.set_landings(landings);
+	my_simulator.set_output_sinks(parse_sinks("summary"));
+	my_simulator.set_output_prefix(directory);
+	my_simulator.process();
+	cerr.rdbuf(cerr_buffer);
+	
+	int count = 0;
+	list_files(directory, names);
+	for(int i = 0; i < names.size(); i++)
+	{
+		if(names[i] == "summary_output.txt" || names[i] == "profile.json")
+			continue;
+		mismatches.push_back(directory + names[i] + " was written by a summary-only run");
+		count++;
+	}
+	
+	// columns of the summary and of a TOTAL row
+	const int SUMMARY_DISTRIBUTED = 2, SUMMARY_USED = 3;
+	const int TOTAL_BYCATCH = 19, TOTAL_CREDITS = 22;
+	
+	string summary_file = directory + "summary_output.txt";
+	ifstream summary(summary_file.c_str());
+	string line, total_line;
+	vector<string> fields, totals;
+	char name[40];
+	int year = 2000;
+	getline(summary, line);
+	for(; getline(summary, line); year++)
+	{
+		sprintf(name, "vessel_data.%d.csv", year);
+		ifstream golden((options.golden_dir + name).c_str());
+		while(getline(golden, total_line) && total_line.compare(0, 5, "TOTAL") != 0)
+			;
+		split_fields(line, fields, '\t');
+		split_fields(total_line, totals);
+		sprintf(name, "%d", year);
+		if(fields.size() <= SUMMARY_USED || totals.size() <= TOTAL_CREDITS || fields[0] != name || 
+		   !fields_match(totals[TOTAL_CREDITS], fields[SUMMARY_DISTRIBUTED], options.tolerance) || 
+		   !fields_match(totals[TOTAL_BYCATCH], fields[SUMMARY_USED], options.tolerance))
+		{
+			mismatches.push_back(summary_file + ": the " + name + " row does not match the golden totals");
+			count++;
+		}
+	}
+	if(year != 2008)
+	{
+		mismatches.push_back(summary_file + ": wrong number of years");
+		count++;
+	}
+	return count;
+}
+
+// runs with the fleet series on and checks each year's series against the
+// credit_supply_demand file of the same run: every day must be one of its
+// days, the fleet's pollock to date can never exceed the pollock landed to
+// date, and what is left at the end of each season must be the year's
+// unfished pollock; returns the number of years that do not agree
+static int fleet_series_mismatches(const vector<landing> & landings, const verify_options & options, 
+								   vector<string> & mismatches)
+{
+	string prefix = options.output_dir + "fleet.";
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	simulator my_simulator;
+	my_simulator.set_landings(landings);
+	my_simulator.set_output_sinks(CSV_SINK);
+	my_simulator.set_fleet_series(true);
+	my_simulator.set_output_prefix(prefix);
+	my_simulator.process();
+	cerr.rdbuf(cerr_buffer);
+	
+	// columns of the three files
+	const int SUPPLY_POLLOCK_STD = 3;
+	const int SERIES_POLLOCK_A = 3;
+	
+	ifstream unfished((prefix + "unfished_pollock.csv").c_str());
+	string line;
+	vector<string> fields;
+	getline(unfished, line);
+	
+	char name[40];
+	int count = 0;
+	for(int year = 2000; year <= 2007; year++)
+	{
+		bool bad = !getline(unfished, line);
+		split_fields(line, fields);
+		double unfished_pollock[2] = {0, 0};
+		for(int s = 0; !bad && s < 2; s++)
+			bad = (fields.size() != 3 || !is_number(fields[1 + s], unfished_pollock[s]));
+		
+		// pollock landed to date on each day, and its season
+		map<string, pair<int, double> > landed;
+		sprintf(name, "credit_supply_demand.%d.csv", year);
+		ifstream supply((prefix + name).c_str());
+		int season = 0;
+		getline(supply, line);
+		while(getline(supply, line))
+		{
+			split_fields(line, fields);
+			double pollock;
+			if(line.empty())
+				season = 1;
+			else if(fields.size() > SUPPLY_POLLOCK_STD && is_number(fields[SUPPLY_POLLOCK_STD], pollock))
+				landed[fields[0]] = make_pair(season, pollock);
+		}
+		
+		sprintf(name, "fleet_series.%d.csv", year);
+		ifstream series((prefix + name).c_str());
+		double left[2] = {-1, -1};
+		int num_days = 0;
+		bad = bad || !getline(series, line);
+		while(!bad && getline(series, line))
+		{
+			split_fields(line, fields);
+			map<string, pair<int, double> >::iterator day = landed.find(fields[0]);
+			double fished;
+			if(day == landed.end() || fields.size() <= SERIES_POLLOCK_A + 1 || 
+			   !is_number(fields[SERIES_POLLOCK_A + day->second.first], fished) || 
+			   fished > day->second.second * (1 + options.tolerance))
+			{
+				bad = true;
+				break;
+			}
+			left[day->second.first] = day->second.second - fished;
+			num_days++;
+		}
+		for(int s = 0; !bad && s < 2; s++)
+			bad = fabs(left[s] - unfished_pollock[s]) > 1;
+		if(bad || num_days == 0)
+		{
+			mismatches.push_back(prefix + name + " does not agree with the run's credit_supply_demand and unfished_pollock");
+			count++;
+		}
+	}
+	return count;
+}
+
+// stores the credit factors of a run, starts a second run at 2004 from them and
+// compares its files for 2004-2007 with the golden ones; a store must also be
+// refused once the policy parameters differ from those it was saved under;
+// returns the number of problems found
+static int warm_start_mismatches(const vector<landing> & landings, const verify_options & options, 
+								 const vector<string> & golden_files, vector<string> & mismatches)
+{
+	const int FIRST_YEAR = 2004;
+	string prefix = options.output_dir + "warm.";
+	discard_buffer discard;
+	streambuf * cerr_buffer = cerr.rdbuf(&discard);
+	simulator cold;
+	cold.set_landings(landings);
+	cold.set_output_sinks(STORE_SINK);
+	cold.set_output_prefix(prefix);
+	cold.process();
+	
+	simulator warm;
+	warm.set_landings(landings);
+	warm.set_output_sinks(CSV_SINK | STORE_SINK);
+	warm.set_output_prefix(prefix);
+	bool started = warm.warm_start(FIRST_YEAR);
+	warm.process(FIRST_YEAR);
+	
+	policy_params other = warm.get_params();
+	other.TARGET_CAP *= 0.9;
+	warm.set_params(other);
+	bool refused = !warm.warm_start(FIRST_YEAR);
+	cerr.rdbuf(cerr_buffer);
+	
+	int count = 0;
+	if(!started)
+	{
+		mismatches.push_back(prefix + "credit_factors.2003.dat was not accepted for a warm start");
+		count++;
+	}
+	if(!refused)
+	{
+		mismatches.push_back(prefix + "credit_factors.2003.dat was accepted under another target cap");
+		count++;
+	}
+	char year_part[40];
+	for(int year = FIRST_YEAR; year <= 2007; year++)
+	{
+		sprintf(year_part, ".%d.", year);
+		for(int i = 0; i < golden_files.size(); i++)
+			if(golden_files[i].find(year_part) != string::npos && 
+			   compare_csv(options.golden_dir + golden_files[i], prefix + golden_files[i], 
+						   options.tolerance, mismatches) > 0)
+				count++;
+	}
+	return count;
+}
+
+static double peak_rss_mb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0);	// bytes
+#else
+	return usage.ru_maxrss / 1024.0;				// kilobytes
+#endif
+}
+
+int run_verify(const verify_options & options)
+{
+	// golden files to reproduce
+	vector<string> golden_files;
+	DIR * dir = opendir(options.golden_dir.c_str());
+	if(dir == NULL)
+	{
+		cerr << "could not open " << options.golden_dir << ".\n";
+		return 1;
+	}
+	struct dirent * entry;
+	while((entry = readdir(dir)) != NULL)
+	{
+		string name = entry->d_name;
+		if(name.length() > 4 && name.compare(name.length() - 4, 4, ".csv") == 0)
+			golden_files.push_back(name);
+	}
+	closedir(dir);
+	sort(golden_files.begin(), golden_files.end());
+	if(golden_files.empty())
+	{
+		cerr << "no golden files in " << options.golden_dir << ".\n";
+		return 1;
+	}
+	
+	ifstream datafile;
+	datafile.open(options.landings_file.c_str());
+	if(!datafile.is_open())
+	{
+		cerr << "could not open " << options.landings_file << ".\n";
+		return 1;
+	}
+	mkdir(options.output_dir.c_str(), 0755);
+	
+	// the simulator reports every year on cerr
+	stringstream quiet;
+	streambuf * cerr_buffer = cerr.rdbuf(quiet.rdbuf());
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	simulator my_simulator;
+	my_simulator.read_in_landings(datafile);
+	datafile.close();
+	double read_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	
+	my_simulator.set_output_prefix(options.output_dir);
+	start = chrono::steady_clock::now();
+	for(int run = 0; run < options.runs; run++)
+		my_simulator.process();
+	double run_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	
+	cerr.rdbuf(cerr_buffer);
+	
+	// compare
+	int total_mismatches = 0;
+	vector<string> mismatches;
+	for(int i = 0; i < golden_files.size(); i++)
+	{
+		int count = compare_csv(options.golden_dir + golden_files[i], options.output_dir + golden_files[i], 
+								options.tolerance, mismatches);
+		if(count > 0)
+			cout << "MISMATCH " << golden_files[i] << ": " << count << " fields\n";
+		total_mismatches += count;
+	}
+	int resume_failures = resume_mismatches(my_simulator.get_landings(), mismatches);
+	int factor_log_failures = factor_log_mismatches(my_simulator.get_landings(), options.output_dir + "factor_log.dat", 
+													options.output_dir + "factor_log.csv", mismatches);
+	int database_failures = database_mismatches(my_simulator.get_landings(), 
+												options.output_dir + "results.sqlite", mismatches);
+	int sweep_failures = sweep_mismatches(my_simulator.get_landings(), options.output_dir, mismatches);
+	int curve_failures = penalty_curve_mismatches(my_simulator.get_landings(), options, golden_files, mismatches);
+	int summary_failures = summary_mismatches(my_simulator.get_landings(), options, mismatches);
+	int fleet_failures = fleet_series_mismatches(my_simulator.get_landings(), options, mismatches);
+	int warm_failures = warm_start_mismatches(my_simulator.get_landings(), options, golden_files, mismatches);
+	for(int i = 0; i < mismatches.size(); i++)
+		cout << "  " << mismatches[i] << "\n";
+	
+	long long allocations = steady_state_allocations(my_simulator, max(options.runs, 1));
+	double penalty_error = penalty_batch_error();
+	bool pass = (total_mismatches == 0 && resume_failures == 0 && factor_log_failures == 0 && 
+				 database_failures <= 0 && sweep_failures == 0 && curve_failures == 0 && 
+				 summary_failures == 0 && fleet_failures == 0 && warm_failures == 0 && allocations == 0 && 
+				 penalty_error <= options.penalty_tolerance);
+	
+	double scenarios_per_second = options.runs / run_seconds;
+	double peak_rss = peak_rss_mb();
+	cout << (pass ? "PASS" : "FAIL") << ": " << golden_files.size() << " files, ";
+	cout << total_mismatches << " mismatched fields, ";
+	cout << resume_failures << " resumed years differing, ";
+	cout << factor_log_failures << " factor log problems, ";
+	if(database_failures < 0)
+		cout << "database not checked (no SQLite), ";
+	else
+		cout << database_failures << " database tables wrong, ";
+	cout << sweep_failures << " sweep files differing, ";
+	cout << curve_failures << " penalty curve problems, ";
+	cout << summary_failures << " summary-only problems, ";
+	cout << fleet_failures << " fleet series years wrong, ";
+	cout << warm_failures << " warm start problems, ";
+	cout << allocations << " steady-state allocations, ";
+	cout << "penalty kernel error " << penalty_error << "\n";
+	cout << "read " << read_seconds << " s, " << options.runs << " runs in " << run_seconds << " s (";
+	cout << scenarios_per_second << " scenarios/s), peak RSS " << peak_rss << " MB\n";
+	
+	csv_buffer out;
+	out << "{\n";
+	out << "  \"pass\": " << (pass ? "true" : "false") << ",\n";
+	out << "  \"files\": " << int(golden_files.size()) << ",\n";
+	out << "  \"mismatched_fields\": " << total_mismatches << ",\n";
+	out << "  \"resume_mismatches\": " << resume_failures << ",\n";
+	out << "  \"factor_log_mismatches\": " << factor_log_failures << ",\n";
+	out << "  \"database_mismatches\": " << database_failures << ",\n";
+	out << "  \"sweep_mismatches\": " << sweep_failures << ",\n";
+	out << "  \"penalty_curve_mismatches\": " << curve_failures << ",\n";
+	out << "  \"summary_mismatches\": " << summary_failures << ",\n";
+	out << "  \"fleet_series_mismatches\": " << fleet_failures << ",\n";
+	out << "  \"warm_start_mismatches\": " << warm_failures << ",\n";
+	out << "  \"steady_state_allocations\": " << long(allocations) << ",\n";
+	out << "  \"penalty_batch_error\": " << penalty_error << ",\n";
+	out << "  \"tolerance\": " << options.tolerance << ",\n";
+	out << "  \"runs\": " << options.runs << ",\n";
+	out << "  \"read_seconds\": " << read_seconds << ",\n";
+	out << "  \"run_seconds\": " << run_seconds << ",\n";
+	out << "  \"scenarios_per_second\": " << scenarios_per_second << ",\n";
+	out << "  \"peak_rss_mb\": " << peak_rss << "\n";
+	out << "}\n";
+	if(!out.save(options.report_file))
+		cerr << "could not write " << options.report_file << ".\n";
+	
+	return pass ? 0 : 1;
+}
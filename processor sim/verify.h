@@ -0,0 +1,49 @@
+/*
+ *  verify.h
+ *  processor
+ *
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct verify_options
+{
+	string landings_file;
+	string golden_dir;		// every .csv here must be reproduced
+	string output_dir;		// where the runs write their output
+	string report_file;		// JSON summary of the run
+	int runs;				// full 2000-2007 runs to time
+	double tolerance;		// relative tolerance for non-integer fields
+	double penalty_tolerance;	// largest allowed gap between batched and scalar penalty curves
+};
+
+verify_options default_verify_options();
+
+// acceptance gate for changes to the simulator: runs process() on the bundled
+// landings, compares the output against the golden files (integers exactly,
+// other numbers within the tolerance, text exactly) and reports wall time,
+// peak RSS and scenarios per second. It then checks that replays resumed from
+// a checkpoint after a parameter change match fresh replays, round-trips a run
+// through the factor log, writes a run to a results database and counts its
+// rows (in HAVE_SQLITE builds), runs a sweep as a scenario tree and checks
+// its files against separate runs of each scenario, runs penalty curves
+// defined in a file (a copy of the linear curve must reproduce the golden
+// files and a different curve must change them), checks that a summary-only
+// run writes just a summary that agrees with the golden totals, checks the
+// fleet series against the daily totals of the same run, starts a run at 2004
+// from stored credit factors and compares it with the golden files (and checks
+// that factors stored under other parameters are refused), repeats the runs
+// with every output sink off and counts heap allocations after a warm-up run,
+// which must be zero, and checks the batched penalty kernels against their
+// scalar references. Returns 0 when every check passes.
+int run_verify(const verify_options & options);
+int compare_csv(const string & golden_file, const string & output_file, const double tolerance, 
+				vector<string> & mismatches);
+
+#endif
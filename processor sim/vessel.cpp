@@ -9,42 +9,106 @@
 
 
 
+#include <algorithm>
 #include "vessel.h"
+#include "simulator_tools.h"
 
-vessel::vessel()
+catch_series::catch_series()
 {
+	season_start = 0;
+}
+
+void catch_series::clear()
+{
+	days.clear();
 	pollock.clear();
 	chinook.clear();
 	pollock_std.clear();
-	chinook_std.clear();
+	season_start = 0;
+	return;
+}
+
+// hauls normally arrive in date order, so this is an append or an addition
+// to the last day
+void catch_series::add(const int day, const double pollock, const int chinook)
+{
+	int k = days.size();
+	if(k == 0 || days[k-1] < day)
+	{
+		days.push_back(day);
+		this->pollock.push_back(pollock);
+		this->chinook.push_back(chinook);
+		return;
+	}
 	
-	hit_A_limit = false;
-	hit_B_limit = false;
-	credits_bought_A = 0;
-	credits_bought_B = 0;
+	k = lower_bound(days.begin(), days.end(), day) - days.begin();
+	if(days[k] != day)
+	{
+		days.insert(days.begin() + k, day);
+		this->pollock.insert(this->pollock.begin() + k, 0.0);
+		this->chinook.insert(this->chinook.begin() + k, 0);
+	}
+	this->pollock[k] += pollock;
+	this->chinook[k] += chinook;
+	return;
 }
 
-vessel::~vessel()
+// pollock to date, starting over on season_start
+void catch_series::accumulate(const int season_start)
+{
+	this->season_start = season_start;
+	pollock_std = pollock;
+	int first_B = lower_bound(days.begin(), days.end(), season_start) - days.begin();
+	prefix_sum(pollock_std.data(), first_B);
+	prefix_sum(pollock_std.data() + first_B, days.size() - first_B);
+	return;
+}
+
+int catch_series::size() const
 {
+	return days.size();
 }
 
-void vessel::set_name(string name)
+// the last day fished on or before day, -1 if none
+int catch_series::find(const int day) const
+{
+	return int(upper_bound(days.begin(), days.end(), day) - days.begin()) - 1;
+}
+
+double catch_series::pollock_to_date(const int day) const
+{
+	int k = find(day);
+	if(k < 0 || (days[k] < season_start && day >= season_start))
+		return 0;
+	return pollock_std[k];
+}
+
+vessel_year::vessel_year()
+{
+	id = 0;
+	pollock_total = 0;
+	pollock_A = 0;
+	pollock_B = 0;
+}
+
+void vessel_year::set_name(string name)
 {
 	this->name = name;
 	return;
 }
 
-void vessel::set_coop(string coop)
+void vessel_year::set_coop(string coop)
 {
 	this->coop = coop;
 	return;
 }
 
-void vessel::set_num_days(int num_days)
+vessel::vessel()
+{
+	credits_bought_A = 0;
+	credits_bought_B = 0;
+}
+
+vessel::~vessel()
 {
-	pollock.assign(num_days, 0);
-	chinook.assign(num_days, 0);
-	pollock_std.assign(num_days, 0);
-	chinook_std.assign(num_days, 0);
-	return;
 }
\ No newline at end of file
@@ -15,41 +15,77 @@
 
 using namespace std;
 
-class vessel
+// what a vessel landed on each day it fished, in day order, with its pollock
+// to date for the season; vessels fish a small share of the days in a year,
+// so this stands in for arrays over every day
+class catch_series
 	{
 	public:
-		vessel();
-		~vessel();
+		catch_series();
 		
-		string name;
-		string coop;
+		vector<int> days;
 		vector<double> pollock;
 		vector<int> chinook;
 		vector<double> pollock_std;
-		vector<int> chinook_std;
-		int credits;
 		
-		int init_credits_A, init_credits_B;
+		void clear();
+		void add(const int day, const double pollock, const int chinook);
+		void accumulate(const int season_start);
+		int size() const;
+		int find(const int day) const;
+		double pollock_to_date(const int day) const;
+		
+	private:
+		int season_start;
+	};
+
+// what a vessel landed over a year; built once from the landings and shared
+// by every scenario that replays the year
+class vessel_year
+	{
+	public:
+		vessel_year();
+		
+		string name;
+		string coop;
+		int id;
+		catch_series daily;
 		double pollock_total, pollock_A, pollock_B;
+		
+		void set_name(string name);
+		void set_coop(string coop);
+	};
+
+// the part of a vessel that changes haul by haul in a replay, kept small so
+// a scenario's fleet stays in cache
+struct vessel_state
+{
+	int credits;
+	int actual_chinook_A, actual_chinook_B;
+	int out_date_A, out_date_B;
+	double actual_pollock_A, actual_pollock_B;
+	bool done_A, done_B;
+	bool hit_A_limit, hit_B_limit;
+};
+
+// a vessel's allocation and results for one scenario's year
+class vessel
+	{
+	public:
+		vessel();
+		~vessel();
+		
+		int init_credits_A, init_credits_B;
 		int chinook_total, chinook_A, chinook_B;
 		double bycatch_rate_total, bycatch_rate_A, bycatch_rate_B;
 		double credit_perc_A, credit_perc_B, credit_factor_A, credit_factor_B;
 		double z_A, z_B, q_A, q_B;
-		bool hit_A_limit, hit_B_limit;
-		bool done_A, done_B;
 		double credits_bought_A, credits_bought_B;
-		int out_date_A, out_date_B;
 		
-		double actual_pollock_A, actual_pollock_B;
-		int actual_chinook_A, actual_chinook_B;
 		double actual_bycatch_rate_A, actual_bycatch_rate_B;
 		double uncaught_pollock_A, uncaught_pollock_B;
 		double cim_A, cim_B;
 		
-		void set_name(string name);
-		void set_coop(string coop);
-		void set_num_days(int num_days);
-		
 	private:
 		
 	};